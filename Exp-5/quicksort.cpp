@@ -3,55 +3,68 @@
 #include <cstdlib>
 #include <ctime>
 #include <chrono>
+#include <functional>
+#include <type_traits>
 
 using namespace std;
 using namespace std::chrono;
 
-void swap(int &a, int &b) {
-    int temp = a;
+template <class T>
+void swapValues(T &a, T &b) {
+    T temp = a;
     a = b;
     b = temp;
 }
 
-int partition(vector<int> &arr, int low, int high) {
-    int pivot = arr[high];
+template <class T, class Less = less<T>>
+int partition(vector<T> &arr, int low, int high, Less less = {}) {
+    T pivot = arr[high];
     int i = low - 1;
     for (int j = low; j < high; j++) {
-        if (arr[j] < pivot) {
+        if (less(arr[j], pivot)) {
             i++;
-            swap(arr[i], arr[j]);
+            swapValues(arr[i], arr[j]);
         }
     }
-    swap(arr[i + 1], arr[high]);
+    swapValues(arr[i + 1], arr[high]);
     return i + 1;
 }
 
-void quickSort(vector<int> &arr, int low, int high) {
+template <class T, class Less = less<T>>
+void quickSort(vector<T> &arr, int low, int high, Less less = {}) {
     if (low < high) {
-        int pi = partition(arr, low, high);
-        quickSort(arr, low, pi - 1);
-        quickSort(arr, pi + 1, high);
+        int pi = partition(arr, low, high, less);
+        quickSort(arr, low, pi - 1, less);
+        quickSort(arr, pi + 1, high, less);
     }
 }
 
-vector<int> generateRandomNumbers(int n, int maxVal = 100000) {
-    vector<int> arr(n);
+template <class T>
+vector<T> generateRandomNumbers(int n, int maxVal = 100000) {
+    vector<T> arr(n);
     for (int i = 0; i < n; i++) {
-        arr[i] = rand() % maxVal;
+        arr[i] = T(rand() % maxVal) / (is_floating_point<T>::value ? 7 : 1);
     }
     return arr;
 }
 
-int main() {
-    srand(time(0));
+template <class T>
+void timeSorts(const char *typeName) {
     vector<int> sizes = {1000, 5000, 10000, 50000, 100000};
     for (int n : sizes) {
-        vector<int> arr = generateRandomNumbers(n);
+        vector<T> arr = generateRandomNumbers<T>(n);
         auto start = high_resolution_clock::now();
         quickSort(arr, 0, arr.size() - 1);
         auto end = high_resolution_clock::now();
         auto duration = duration_cast<milliseconds>(end - start);
-        cout << "Time taken to sort " << n << " elements: " << duration.count() << " milliseconds." << endl;
+        cout << "Time taken to sort " << n << " " << typeName << " elements: " << duration.count() << " milliseconds." << endl;
     }
+}
+
+int main() {
+    srand(time(0));
+    timeSorts<int>("int");
+    timeSorts<long long>("long long");
+    timeSorts<double>("double");
     return 0;
 }
@@ -1,7 +1,104 @@
 #include <iostream>
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
 using namespace std;
 
+const long long TILE = 1 << 13;                 // 8K words = 64 KB (512K sums) per tile
+const long long TABLE_LIMIT = 1LL << 24;        // above this many cells, drop the 2-D table
+
+// Workers that sweep one DP row at a time. Cells of a row are independent, so
+// the row is cut into tiles handed out through an atomic counter; run() returns
+// once every tile is done, which is the only barrier between rows.
+class RowPool {
+    vector<thread> workers;
+    mutex mtx;
+    condition_variable wake, done;
+    function<void(long long, long long)> kernel;
+    long long length = 0;
+    atomic<long long> nextTile{0};
+    int generation = 0, busy = 0;
+    bool stopping = false;
+
+    void sweep() {
+        long long tiles = (length + TILE - 1) / TILE;
+        for (long long t; (t = nextTile.fetch_add(1)) < tiles; )
+            kernel(t * TILE, min(length, (t + 1) * TILE));
+    }
+
+    void loop() {
+        int seen = 0;
+        while (true) {
+            {
+                unique_lock<mutex> lock(mtx);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            sweep();
+            lock_guard<mutex> lock(mtx);
+            if (--busy == 0) done.notify_one();
+        }
+    }
+
+public:
+    explicit RowPool(int threads) {
+        for (int i = 1; i < threads; i++) workers.emplace_back(&RowPool::loop, this);
+    }
+
+    ~RowPool() {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &t : workers) t.join();
+    }
+
+    void run(long long len, function<void(long long, long long)> k) {
+        {
+            lock_guard<mutex> lock(mtx);
+            kernel = move(k);
+            length = len;
+            nextTile = 0;
+            busy = workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+        sweep();
+        unique_lock<mutex> lock(mtx);
+        done.wait(lock, [&] { return busy == 0; });
+    }
+};
+
+int threadCount(long long words) {
+    int hw = max(1u, thread::hardware_concurrency());
+    return (int)max(1LL, min<long long>(hw, words / (4 * TILE)));
+}
+
+// cur = prev | (prev << shift) on the words in [lo, hi); 64 sums per operation
+// and a branch-free body the compiler vectorises.
+void orKernel(const uint64_t *__restrict prev, uint64_t *__restrict cur, long long lo, long long hi, long long shift) {
+    long long ws = shift / 64;
+    int bs = shift % 64;
+    long long k = lo;
+    for (; k < hi && k < ws; k++) cur[k] = prev[k];
+    if (k < hi && k == ws) {
+        cur[k] = prev[k] | (prev[0] << bs);
+        k++;
+    }
+    if (bs == 0) {
+        for (; k < hi; k++) cur[k] = prev[k] | prev[k - ws];
+    } else {
+        for (; k < hi; k++) cur[k] = prev[k] | (prev[k - ws] << bs) | (prev[k - ws - 1] >> (64 - bs));
+    }
+}
+
 bool subsetSumDP(const vector<int> &arr, int n, int sum) {
     vector<vector<bool>> dp(n + 1, vector<bool>(sum + 1, false));
 
@@ -19,6 +116,26 @@ bool subsetSumDP(const vector<int> &arr, int n, int sum) {
     return dp[n][sum];
 }
 
+// Same recurrence as subsetSumDP with each row packed into 64-bit words and
+// filled by the pool, so sums around 10^8 need only two 12 MB rows.
+bool subsetSumParallel(const vector<int> &arr, int n, int sum) {
+    long long words = sum / 64 + 1;
+    vector<uint64_t> prev(words, 0), cur(words, 0);
+    prev[0] = 1;
+    RowPool pool(threadCount(words));
+
+    for (int i = 0; i < n; i++) {
+        if (arr[i] <= 0 || arr[i] > sum) continue;
+        pool.run(words, [&](long long lo, long long hi) {
+            orKernel(prev.data(), cur.data(), lo, hi, arr[i]);
+        });
+        prev.swap(cur);
+        if (prev[sum / 64] >> (sum % 64) & 1) return true;
+    }
+
+    return prev[sum / 64] >> (sum % 64) & 1;
+}
+
 int main() {
     int n, sum;
     cout << "Enter number of elements: ";
@@ -29,7 +146,10 @@ int main() {
     cout << "Enter sum: ";
     cin >> sum;
 
-    if (subsetSumDP(arr, n, sum))
+    bool found = (long long)(n + 1) * (sum + 1) <= TABLE_LIMIT
+                 ? subsetSumDP(arr, n, sum)
+                 : subsetSumParallel(arr, n, sum);
+    if (found)
         cout << "Subset with given sum exists\n";
     else
         cout << "No subset with given sum\n";
@@ -1,7 +1,112 @@
 #include <iostream>
 #include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 using namespace std;
 
+const long long TILE = 1 << 14;                 // 16K cells = 64 KB per tile, stays in L2
+const long long TABLE_LIMIT = 1LL << 24;        // above this many cells, drop the 2-D table
+
+// Workers that sweep one DP row at a time. Cells of a row are independent, so
+// the row is cut into tiles handed out through an atomic counter; run() returns
+// once every tile is done, which is the only barrier between rows.
+class RowPool {
+    vector<thread> workers;
+    mutex mtx;
+    condition_variable wake, done;
+    function<void(long long, long long)> kernel;
+    long long length = 0;
+    atomic<long long> nextTile{0};
+    int generation = 0, busy = 0;
+    bool stopping = false;
+
+    void sweep() {
+        long long tiles = (length + TILE - 1) / TILE;
+        for (long long t; (t = nextTile.fetch_add(1)) < tiles; )
+            kernel(t * TILE, min(length, (t + 1) * TILE));
+    }
+
+    void loop() {
+        int seen = 0;
+        while (true) {
+            {
+                unique_lock<mutex> lock(mtx);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            sweep();
+            lock_guard<mutex> lock(mtx);
+            if (--busy == 0) done.notify_one();
+        }
+    }
+
+public:
+    explicit RowPool(int threads) {
+        for (int i = 1; i < threads; i++) workers.emplace_back(&RowPool::loop, this);
+    }
+
+    ~RowPool() {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &t : workers) t.join();
+    }
+
+    void run(long long len, function<void(long long, long long)> k) {
+        {
+            lock_guard<mutex> lock(mtx);
+            kernel = move(k);
+            length = len;
+            nextTile = 0;
+            busy = workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+        sweep();
+        unique_lock<mutex> lock(mtx);
+        done.wait(lock, [&] { return busy == 0; });
+    }
+};
+
+int threadCount(long long cells) {
+    int hw = max(1u, thread::hardware_concurrency());
+    return (int)max(1LL, min<long long>(hw, cells / (4 * TILE)));
+}
+
+// cur[w] = max(prev[w], prev[w - wt] + val) for w in [lo, hi)
+void maxKernel(const int *__restrict prev, int *__restrict cur, long long lo, long long hi, int wt, int val) {
+    long long w = lo;
+    for (; w < hi && w < wt; w++) cur[w] = prev[w];
+#if defined(__AVX2__)
+    __m256i add = _mm256_set1_epi32(val);
+    for (; w + 8 <= hi; w += 8) {
+        __m256i keep = _mm256_loadu_si256((const __m256i *)(prev + w));
+        __m256i take = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(prev + w - wt)), add);
+        _mm256_storeu_si256((__m256i *)(cur + w), _mm256_max_epi32(keep, take));
+    }
+#elif defined(__SSE2__)
+    __m128i add = _mm_set1_epi32(val);
+    for (; w + 4 <= hi; w += 4) {
+        __m128i keep = _mm_loadu_si128((const __m128i *)(prev + w));
+        __m128i take = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(prev + w - wt)), add);
+        __m128i more = _mm_cmpgt_epi32(take, keep);
+        _mm_storeu_si128((__m128i *)(cur + w), _mm_or_si128(_mm_and_si128(more, take), _mm_andnot_si128(more, keep)));
+    }
+#endif
+    for (; w < hi; w++) cur[w] = max(prev[w], prev[w - wt] + val);
+}
+
 int knapsackDP(const vector<int> &weights, const vector<int> &values, int n, int W) {
     vector<vector<int>> dp(n + 1, vector<int>(W + 1, 0));
 
@@ -17,19 +122,73 @@ int knapsackDP(const vector<int> &weights, const vector<int> &values, int n, int
     return dp[n][W];
 }
 
-int main() {
+// Same recurrence as knapsackDP, but only two rows are kept and each row is
+// filled by the pool, so W around 10^8 fits in memory and uses every core.
+int knapsackParallel(const vector<int> &weights, const vector<int> &values, int n, int W) {
+    vector<int> prev(W + 1, 0), cur(W + 1, 0);
+    RowPool pool(threadCount(W + 1));
+
+    for (int i = 0; i < n; i++) {
+        int wt = weights[i], val = values[i];
+        if (wt > W) continue;
+        pool.run(W + 1, [&](long long lo, long long hi) {
+            maxKernel(prev.data(), cur.data(), lo, hi, wt, val);
+        });
+        prev.swap(cur);
+    }
+
+    return prev[W];
+}
+
+// Bounded knapsack: item i may be taken up to counts[i] times. Each count is
+// split into 1, 2, 4, ..., rest copies so the 0/1 solver sees O(log count) items.
+int boundedKnapsack(const vector<int> &weights, const vector<int> &values, const vector<long long> &counts, int W) {
+    vector<int> splitWeights, splitValues;
+    for (int i = 0; i < (int)weights.size(); i++) {
+        long long left = weights[i] > 0 ? min<long long>(counts[i], W / weights[i]) : 0;
+        for (long long k = 1; left > 0; k *= 2) {
+            long long take = min(k, left);
+            splitWeights.push_back((int)(take * weights[i]));
+            splitValues.push_back((int)(take * values[i]));
+            left -= take;
+        }
+    }
+    return knapsackParallel(splitWeights, splitValues, splitWeights.size(), W);
+}
+
+// Unbounded knapsack is the bounded case with every count capped by W / weight.
+int unboundedKnapsack(const vector<int> &weights, const vector<int> &values, int W) {
+    vector<long long> counts(weights.size(), W);
+    return boundedKnapsack(weights, values, counts, W);
+}
+
+int main(int argc, char *argv[]) {
+    string variant = argc > 1 ? argv[1] : "01";
     int n, W;
     cout << "Enter number of items: ";
     cin >> n;
     vector<int> weights(n), values(n);
+    vector<long long> counts(n, 1);
     cout << "Enter weights of items: ";
     for (int i = 0; i < n; i++) cin >> weights[i];
     cout << "Enter values of items: ";
     for (int i = 0; i < n; i++) cin >> values[i];
+    if (variant == "bounded") {
+        cout << "Enter counts of items: ";
+        for (int i = 0; i < n; i++) cin >> counts[i];
+    }
     cout << "Enter capacity of knapsack: ";
     cin >> W;
 
-    int maxValue = knapsackDP(weights, values, n, W);
+    int maxValue;
+    if (variant == "unbounded")
+        maxValue = unboundedKnapsack(weights, values, W);
+    else if (variant == "bounded")
+        maxValue = boundedKnapsack(weights, values, counts, W);
+    else if ((long long)(n + 1) * (W + 1) <= TABLE_LIMIT)
+        maxValue = knapsackDP(weights, values, n, W);
+    else
+        maxValue = knapsackParallel(weights, values, n, W);
     cout << "Maximum value in Knapsack: " << maxValue << endl;
 
     return 0;
@@ -1,6 +1,12 @@
 #include <iostream>
 #include <vector>
 #include <queue>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <algorithm>
 using namespace std;
 
 const int INF = 1e9;
@@ -31,7 +37,128 @@ void dijkstra(int src, const vector<vector<pair<int,int>>> &adj, vector<int> &di
     }
 }
 
-int main() {
+class SpinBarrier {
+    const int count;
+    atomic<int> waiting{0};
+    atomic<unsigned> generation{0};
+public:
+    explicit SpinBarrier(int n) : count(n) {}
+    void wait() {
+        unsigned gen = generation.load();
+        if (waiting.fetch_add(1) + 1 == count) {
+            waiting.store(0);
+            generation.fetch_add(1);
+        } else {
+            while (generation.load() == gen) this_thread::yield();
+        }
+    }
+};
+
+// Delta-stepping: bucket k holds vertices with dist in [k*delta, (k+1)*delta).
+// The current bucket is drained by relaxing light edges (w <= delta) in
+// parallel until nothing falls back into it; then every vertex settled there
+// relaxes its heavy edges once. Distances only go down, through atomic CAS, so
+// the result equals dijkstra() for non-negative weights.
+void deltaStepping(int src, const vector<vector<pair<int,int>>> &adj, vector<int> &dist, int delta, int threads) {
+    int n = adj.size();
+    int maxW = 1;
+    double edges = 0;
+    vector<vector<pair<int,int>>> sorted(n);      // (weight, v), light edges first
+    for (int u = 0; u < n; u++) {
+        for (auto edge : adj[u]) {
+            sorted[u].push_back({edge.second, edge.first});
+            maxW = max(maxW, edge.second);
+        }
+        sort(sorted[u].begin(), sorted[u].end());
+        edges += adj[u].size();
+    }
+    if (delta <= 0) delta = max(1, (int)(maxW / max(1.0, edges / max(1, n))));   // ~ maxWeight / degree
+    delta = max(delta, maxW / (1 << 16) + 1);
+    int slots = maxW / delta + 3;                 // pending buckets always fit in a ring this size
+
+    unique_ptr<atomic<int>[]> d(new atomic<int>[n]);
+    unique_ptr<atomic<bool>[]> inBucket(new atomic<bool>[n]);
+    for (int i = 0; i < n; i++) { d[i] = INF; inBucket[i] = false; }
+    vector<vector<vector<int>>> bins(threads, vector<vector<int>>(slots));
+    vector<priority_queue<int, vector<int>, greater<int>>> pending(threads);
+    vector<vector<int>> settled(threads);
+    vector<int> frontier;
+    mutex lock;
+    atomic<size_t> next{0};
+    atomic<int> nextBucket{INF};
+    int current = 0;
+    bool done = false;
+    SpinBarrier barrier(threads);
+
+    d[src] = 0;
+    bins[0][0].push_back(src);
+    pending[0].push(0);
+
+    auto worker = [&](int t) {
+        auto relax = [&](int u, bool light) {
+            int du = d[u];
+            for (auto edge : sorted[u]) {
+                if ((edge.first <= delta) != light) continue;
+                int v = edge.second, nd = du + edge.first;
+                int old = d[v];
+                while (nd < old && !d[v].compare_exchange_weak(old, nd)) {}
+                if (nd >= old) continue;
+                auto &bin = bins[t][nd / delta % slots];
+                if (bin.empty()) pending[t].push(nd / delta);
+                bin.push_back(v);
+            }
+        };
+        while (true) {
+            auto &mine = bins[t][current % slots];
+            if (!mine.empty()) {
+                lock_guard<mutex> guard(lock);
+                frontier.insert(frontier.end(), mine.begin(), mine.end());
+            }
+            mine.clear();
+            while (!pending[t].empty() && pending[t].top() == current) pending[t].pop();
+            barrier.wait();
+
+            if (frontier.empty()) {
+                for (int u : settled[t]) { relax(u, false); inBucket[u] = false; }
+                settled[t].clear();
+                if (!pending[t].empty()) {
+                    int mineNext = pending[t].top(), seen = nextBucket;
+                    while (mineNext < seen && !nextBucket.compare_exchange_weak(seen, mineNext)) {}
+                }
+                barrier.wait();
+                if (t == 0) {
+                    done = nextBucket == INF;
+                    current = nextBucket;
+                    nextBucket = INF;
+                }
+                barrier.wait();
+                if (done) break;
+                continue;
+            }
+
+            for (size_t i; (i = next.fetch_add(1)) < frontier.size();) {
+                int u = frontier[i];
+                if (d[u] / delta != current) continue;           // moved to an earlier bucket
+                if (!inBucket[u].exchange(true)) settled[t].push_back(u);
+                relax(u, true);
+            }
+            barrier.wait();
+            if (t == 0) { frontier.clear(); next = 0; }
+            barrier.wait();
+        }
+    };
+
+    vector<thread> pool;
+    for (int t = 1; t < threads; t++) pool.emplace_back(worker, t);
+    worker(0);
+    for (auto &th : pool) th.join();
+    dist.assign(n, INF);
+    for (int i = 0; i < n; i++) dist[i] = d[i];
+}
+
+int main(int argc, char *argv[]) {
+    // "delta [delta] [threads]" runs delta-stepping on the same input; delta 0 picks it.
+    string mode = argc > 1 ? argv[1] : "";
     int n, m;
     cout << "Enter number of vertices and edges: ";
     cin >> n >> m;
@@ -49,7 +176,13 @@ int main() {
     cin >> src;
 
     vector<int> dist;
-    dijkstra(src, adj, dist);
+    if (mode == "delta") {
+        int delta = argc > 2 ? stoi(argv[2]) : 0;
+        int threads = argc > 3 ? stoi(argv[3]) : max(1u, thread::hardware_concurrency());
+        deltaStepping(src, adj, dist, delta, max(1, threads));
+    } else {
+        dijkstra(src, adj, dist);
+    }
 
     cout << "Shortest distances from vertex " << src << ":\n";
     for (int i = 0; i < n; i++) {
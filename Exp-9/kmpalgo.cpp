@@ -1,6 +1,15 @@
 #include <iostream>
 #include <vector>
+#include <string>
+#include <cstring>
+#include <chrono>
+#include <random>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
 using namespace std;
+using namespace std::chrono;
 
 vector<int> computeLPS(const string &P) {
     int m = P.size();
@@ -24,12 +33,12 @@ vector<int> computeLPS(const string &P) {
     return lps;
 }
 
-vector<int> KMPSearch(const string &S, const string &P) {
+// KMP over S starting at text index `from`; reports every match starting there or later.
+void KMPSearchFrom(const string &S, const string &P, int from, vector<int> &occurrences) {
     int n = S.size();
     int m = P.size();
     vector<int> lps = computeLPS(P);
-    vector<int> occurrences;
-    int i = 0, j = 0;
+    int i = from, j = 0;
     while (i < n) {
         if (S[i] == P[j]) {
             i++;
@@ -45,17 +54,150 @@ vector<int> KMPSearch(const string &S, const string &P) {
                 i++;
         }
     }
+}
+
+vector<int> KMPSearch(const string &S, const string &P) {
+    vector<int> occurrences;
+    KMPSearchFrom(S, P, 0, occurrences);
+    return occurrences;
+}
+
+// Generic SIMD substring search: compare a block of text against the pattern's
+// first and last byte at once and memcmp only where both agree. Verification
+// work is budgeted against the bytes scanned; on periodic input (e.g. "aaaa"
+// in "aaaa...") the budget runs out and the scan hands the rest of the text
+// to KMP, so the worst case stays linear.
+struct FilterScan {
+    const string &S, &P;
+    vector<int> &out;
+    long long verified = 0;
+    bool exhausted = false;
+
+    // Verifies every candidate in the block; returns false once verification
+    // has cost more than the budget, and the caller stops after this block.
+    bool candidates(unsigned mask, int base) {
+        int m = P.size();
+        while (mask) {
+            int pos = base + __builtin_ctz(mask);
+            mask &= mask - 1;
+            verified += m;
+            if (memcmp(S.data() + pos + 1, P.data() + 1, m - 2) == 0) out.push_back(pos);
+        }
+        exhausted = verified > 4LL * base + 64LL * m + 4096;
+        return !exhausted;
+    }
+};
+
+#ifdef HAVE_X86_SIMD
+int scanSSE2(FilterScan &scan) {
+    const string &S = scan.S, &P = scan.P;
+    int n = S.size(), m = P.size(), i = 0;
+    __m128i first = _mm_set1_epi8(P[0]), last = _mm_set1_epi8(P[m - 1]);
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i bf = _mm_loadu_si128((const __m128i *)(S.data() + i));
+        __m128i bl = _mm_loadu_si128((const __m128i *)(S.data() + i + m - 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, bf), _mm_cmpeq_epi8(last, bl)));
+        if (mask && !scan.candidates(mask, i)) return i + 16;
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) int scanAVX2(FilterScan &scan) {
+    const string &S = scan.S, &P = scan.P;
+    int n = S.size(), m = P.size(), i = 0;
+    __m256i first = _mm256_set1_epi8(P[0]), last = _mm256_set1_epi8(P[m - 1]);
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        __m256i bf = _mm256_loadu_si256((const __m256i *)(S.data() + i));
+        __m256i bl = _mm256_loadu_si256((const __m256i *)(S.data() + i + m - 1));
+        unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, bf), _mm256_cmpeq_epi8(last, bl)));
+        if (mask && !scan.candidates(mask, i)) return i + 32;
+    }
+    return i;
+}
+#endif
+
+const char *simdLevel() {
+#ifdef HAVE_X86_SIMD
+    static const char *level = __builtin_cpu_supports("avx2") ? "avx2" : "sse2";
+    return level;
+#else
+    return "scalar";
+#endif
+}
+
+vector<int> simdSearch(const string &S, const string &P) {
+    int n = S.size(), m = P.size();
+    vector<int> occurrences;
+    if (m == 0 || m > n) return occurrences;
+    if (m == 1) {
+        for (const char *p = S.data(); (p = (const char *)memchr(p, P[0], S.data() + n - p)); ++p)
+            occurrences.push_back(p - S.data());
+        return occurrences;
+    }
+
+    FilterScan scan{S, P, occurrences};
+    int i = 0;
+#ifdef HAVE_X86_SIMD
+    string level = simdLevel();
+    i = level == "avx2" ? scanAVX2(scan) : scanSSE2(scan);
+#endif
+    if (scan.exhausted) {
+        // Every match starting before i is already reported.
+        KMPSearchFrom(S, P, i, occurrences);
+        return occurrences;
+    }
+    for (; i + m <= n; i++)
+        if (S[i] == P[0] && S[i + m - 1] == P[m - 1] && memcmp(S.data() + i + 1, P.data() + 1, m - 2) == 0)
+            occurrences.push_back(i);
     return occurrences;
 }
 
-int main() {
+double timeMs(const string &S, const string &P, vector<int> (*search)(const string &, const string &), vector<int> &result) {
+    auto start = steady_clock::now();
+    result = search(S, P);
+    return duration_cast<duration<double, milli>>(steady_clock::now() - start).count();
+}
+
+void benchmark(int n, int m) {
+    mt19937 rng(42);
+    vector<pair<string, pair<string, string>>> cases;
+
+    string text(n, 'a');
+    for (char &c : text) c = 'a' + rng() % 26;
+    cases.push_back({"random text", {text, text.substr(n / 2, m)}});
+    string dna(n, 'A');
+    for (char &c : dna) c = "ACGT"[rng() % 4];
+    cases.push_back({"dna", {dna, dna.substr(n / 3, m)}});
+    cases.push_back({"periodic", {string(n, 'a'), string(m, 'a')}});
+    cases.push_back({"near miss", {string(n, 'a'), string(m - 1, 'a') + "b"}});
+
+    cout << "SIMD level: " << simdLevel() << ", n = " << n << ", m = " << m << endl;
+    for (auto &[name, input] : cases) {
+        vector<int> a, b;
+        double kmp = timeMs(input.first, input.second, KMPSearch, a);
+        double simd = timeMs(input.first, input.second, simdSearch, b);
+        cout << name << ": KMP " << kmp << " ms, SIMD " << simd << " ms, "
+             << (kmp / max(simd, 1e-6)) << "x, " << a.size() << " matches"
+             << (a == b ? "" : "  MISMATCH") << endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    string mode = argc > 1 ? argv[1] : "";
+    if (mode == "bench") {
+        int n = argc > 2 ? stoi(argv[2]) : 50000000;
+        int m = argc > 3 ? stoi(argv[3]) : 16;
+        benchmark(n, max(2, m));
+        return 0;
+    }
+
     string S, P;
     cout << "Enter string S: ";
     cin >> S;
     cout << "Enter pattern P: ";
     cin >> P;
 
-    vector<int> result = KMPSearch(S, P);
+    vector<int> result = mode == "simd" ? simdSearch(S, P) : KMPSearch(S, P);
     if (result.empty())
         cout << "Pattern not found\n";
     else {
@@ -1,67 +1,258 @@
 #include <iostream>
 #include <vector>
 #include <string>
-#include <sstream>
+#include <string_view>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "trace.h"
+#include "stats.h"
+#include "budget.h"
+#include "arena.h"
 using namespace std;
+using namespace std::chrono;
 int N;
-void emitStep(const vector<string>& board, const string& message, int row, int col, bool placing) {
-    stringstream ss;
-    ss << R"({"board":[)";
+void emitStep(const vector<string>& board, string_view message, int row, int col, bool placing) {
+    if (!traceKeep(traceImportant(message))) return;
+    cout << R"({"board":[)";
     for (int i = 0; i < board.size(); ++i) {
-        ss << "\"" << board[i] << "\"";
-        if (i != board.size() - 1) ss << ",";
+        cout << "\"" << board[i] << "\"";
+        if (i != board.size() - 1) cout << ",";
     }
-    ss << R"(],"message":")" << message << R"(","row":)" << row << R"(,"col":)" << col << R"(,"placing":)" << (placing ? "true" : "false") << "}";
-    cout << ss.str() << endl;
-    cout.flush();
+    cout << R"(],"message":")" << message << R"(","row":)" << row << R"(,"col":)" << col << R"(,"placing":)" << (placing ? "true" : "false") << "}" << endl;
 }
-bool isSafe(const vector<string>& board, int row, int col) {
-    for (int i = 0; i < row; ++i)
-        if (board[i][col] == 'Q') return false;
-    for (int i = row - 1, j = col - 1; i >= 0 && j >= 0; --i, --j)
-        if (board[i][j] == 'Q') return false;
-    for (int i = row - 1, j = col + 1; i >= 0 && j < N; --i, ++j)
-        if (board[i][j] == 'Q') return false;
-    return true;
+
+// Attacked columns and diagonals as bitmasks: bit col, bit row+col and bit
+// row-col+N-1, so a safety check is three bit tests instead of three scans.
+struct QueenMasks {
+    uint64_t cols = 0, diag = 0, anti = 0;
+    void toggle(int row, int col) {
+        cols ^= 1ULL << col;
+        diag ^= 1ULL << (row + col);
+        anti ^= 1ULL << (row - col + N - 1);
+    }
+};
+
+bool isSafe(const QueenMasks& masks, int row, int col) {
+    return !(masks.cols >> col & 1) && !(masks.diag >> (row + col) & 1) && !(masks.anti >> (row - col + N - 1) & 1);
 }
 bool solutionFound = false;
 
-bool solve(vector<string>& board, int row) {
+// Deepest placement reached, reported if the search is stopped early.
+vector<string> bestBoard;
+int bestRow = -1;
+
+bool solve(vector<string>& board, QueenMasks& masks, int row, BudgetTicker& ticker) {
+    if (row > bestRow) {
+        bestRow = row;
+        bestBoard = board;
+    }
     if (row == N) {
         emitStep(board, " Solution found!", -1, -1, false);
         return true; // stop recursion here
     }
 
     for (int col = 0; col < N; ++col) {
-        emitStep(board, "Trying queen at (" + to_string(row) + "," + to_string(col) + ")", row, col, true);
-        if (isSafe(board, row, col)) {
+        statAdd(Stat::Nodes);
+        if (ticker.tick(row)) return false;
+        emitStep(board, stepText("Trying queen at (", row, ",", col, ")"), row, col, true);
+        if (isSafe(masks, row, col)) {
             board[row][col] = 'Q';
-            emitStep(board, "Placed queen at (" + to_string(row) + "," + to_string(col) + ")", row, col, true);
-            if (solve(board, row + 1)) return true; 
+            masks.toggle(row, col);
+            emitStep(board, stepText("Placed queen at (", row, ",", col, ")"), row, col, true);
+            if (solve(board, masks, row + 1, ticker)) return true;
+            if (ticker.stopped()) return false;
             board[row][col] = '.';
-            emitStep(board, "Backtracking from (" + to_string(row) + "," + to_string(col) + ")", row, col, false);
+            masks.toggle(row, col);
+            emitStep(board, stepText("Backtracking from (", row, ",", col, ")"), row, col, false);
         } else {
-            emitStep(board, "Position (" + to_string(row) + "," + to_string(col) + ") is not safe", row, col, false);
+            emitStep(board, stepText("Position (", row, ",", col, ") is not safe"), row, col, false);
         }
     }
 
     return false; // no solution in this path
 }
 
+const int UNCHECKED_ROWS = 10;    // subtrees this shallow are counted without budget checks
+
+// Counting search on bitboards: cols/ld/rd hold the squares of the current
+// row attacked vertically and along each diagonal; avail & -avail picks the
+// next free square without scanning.
+long long countFrom(uint32_t all, uint32_t cols, uint32_t ld, uint32_t rd, long long& nodes) {
+    ++nodes;
+    if (cols == all) return 1;
+    long long count = 0;
+    uint32_t avail = all & ~(cols | ld | rd);
+    while (avail) {
+        uint32_t bit = avail & -avail;
+        avail ^= bit;
+        count += countFrom(all, cols | bit, (ld | bit) << 1, (rd | bit) >> 1, nodes);
+    }
+    return count;
+}
+
+// countFrom with a budget check per node down to the last UNCHECKED_ROWS
+// rows. A stopped search returns the solutions counted so far.
+long long countChecked(int n, uint32_t all, uint32_t cols, uint32_t ld, uint32_t rd, int row, BudgetTicker& ticker) {
+    if (row >= n - UNCHECKED_ROWS) {
+        long long nodes = 0, count = countFrom(all, cols, ld, rd, nodes);
+        ticker.tick(row, nodes);
+        return count;
+    }
+    if (ticker.tick(row)) return 0;
+    if (cols == all) return 1;
+    long long count = 0;
+    uint32_t avail = all & ~(cols | ld | rd);
+    while (avail) {
+        uint32_t bit = avail & -avail;
+        avail ^= bit;
+        count += countChecked(n, all, cols | bit, (ld | bit) << 1, (rd | bit) >> 1, row + 1, ticker);
+    }
+    return count;
+}
+
+struct QueenTask {
+    uint32_t cols, ld, rd;
+    int row;
+    int weight;     // 2 for mirrored first-row placements, 1 for the middle column
+};
+
+// Each worker owns a deque: it pushes and pops subtasks at the back and idle
+// workers steal the oldest (largest) task from the front of another deque.
+class StealingCounter {
+    vector<deque<QueenTask>> queues;
+    vector<mutex> locks;
+    atomic<long long> pending{0}, total{0};
+    uint32_t all;
+    int n, splitRow;
+
+    bool take(int self, QueenTask& task) {
+        {
+            lock_guard<mutex> lock(locks[self]);
+            if (!queues[self].empty()) {
+                task = queues[self].back();
+                queues[self].pop_back();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < queues.size(); ++k) {
+            int victim = (self + k) % queues.size();
+            lock_guard<mutex> lock(locks[victim]);
+            if (!queues[victim].empty()) {
+                task = queues[victim].front();
+                queues[victim].pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void push(int worker, const QueenTask& task) {
+        ++pending;
+        lock_guard<mutex> lock(locks[worker]);
+        queues[worker].push_back(task);
+    }
+
+    void work(int self) {
+        QueenTask task;
+        BudgetTicker ticker;
+        while (pending > 0 && !searchBudget().stopped()) {
+            if (!take(self, task)) {
+                this_thread::yield();
+                continue;
+            }
+            if (task.row < splitRow) {
+                uint32_t avail = all & ~(task.cols | task.ld | task.rd);
+                while (avail) {
+                    uint32_t bit = avail & -avail;
+                    avail ^= bit;
+                    push(self, {task.cols | bit, (task.ld | bit) << 1, (task.rd | bit) >> 1, task.row + 1, task.weight});
+                }
+            } else {
+                total += task.weight * countChecked(n, all, task.cols, task.ld, task.rd, task.row, ticker);
+            }
+            --pending;
+        }
+    }
+
+public:
+    StealingCounter(int n, int threads) : queues(threads), locks(threads), all((1u << n) - 1), n(n), splitRow(min(2, n - 1)) {
+        // Mirror symmetry: first-row columns in the left half count twice,
+        // the middle column of an odd board once.
+        for (int col = 0; col < (n + 1) / 2; ++col) {
+            uint32_t bit = 1u << col;
+            int weight = (n % 2 == 1 && col == n / 2) ? 1 : 2;
+            push(col % threads, {bit, bit << 1, bit >> 1, 1, weight});
+        }
+    }
+
+    long long run() {
+        vector<thread> workers;
+        for (size_t i = 1; i < queues.size(); ++i) workers.emplace_back(&StealingCounter::work, this, (int)i);
+        work(0);
+        for (auto& t : workers) t.join();
+        return total;
+    }
+};
+
+long long countSolutions(int n, int threads) {
+    if (n == 1) return 1;
+    return StealingCounter(n, threads).run();
+}
+
 int main(int argc, char* argv[]) {
+    StatsReport report("n-queen");
+    RunArena arena;
+    if (argc > 1 && string(argv[1]) == "count") {
+        SearchBudget& budget = searchBudget();
+        report.rename("n-queen-count");
+        N = argc > 2 ? stoi(argv[2]) : 8;
+        int threads = argc > 3 ? stoi(argv[3]) : max(1u, thread::hardware_concurrency());
+        if (N < 1 || N > 31 || threads < 1) {
+            cout << R"({"error":"Invalid N"})" << endl;
+            return 1;
+        }
+        auto start = steady_clock::now();
+        long long solutions = countSolutions(N, threads);
+        long long elapsed = duration_cast<milliseconds>(steady_clock::now() - start).count();
+        cout << R"({"action":"count","n":)" << N << R"(,"solutions":)" << solutions
+             << R"(,"threads":)" << threads << R"(,"timeMs":)" << elapsed;
+        // Stopped early: solutions is a lower bound.
+        if (budget.stopped()) cout << R"(,"complete":false,"stopped":")" << budget.stopReason() << R"(","nodes":)" << budget.nodes();
+        cout << "}" << endl;
+        cout << R"({"action":"final"})" << endl;
+        return budget.stopped() ? EXIT_STOPPED : 0;
+    }
+
     if (argc > 1) {
         N = stoi(argv[1]);
     } else {
         cin >> N;
     }
+    // Its cancel watcher reads stdin too, so the budget starts after N is read.
+    SearchBudget& budget = searchBudget();
 
-    if (N < 1) {
+    if (N < 1 || N > 32) {
         cout << R"({"error":"Invalid N"})" << endl;
         return 1;
     }
 
     vector<string> board(N, string(N, '.'));
-    solve(board, 0);
+    QueenMasks masks;
+    bool solved;
+    {
+        BudgetTicker ticker(budget);
+        solved = solve(board, masks, 0, ticker);
+    }
+    if (!solved && budget.stopped()) {
+        emitStep(bestBoard, stepText("Search stopped (", budget.stopReason(), ") after ", budget.nodes(),
+                                     " nodes; best partial placement has ", bestRow, " of ", N, " queens"), -1, -1, false);
+        cout << R"({"action":"final","stopped":")" << budget.stopReason() << R"(","queens":)" << bestRow << "}" << endl;
+        return EXIT_STOPPED;
+    }
 
     cout << R"({"action":"final"})" << endl;
     cout.flush();
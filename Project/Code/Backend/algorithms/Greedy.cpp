@@ -3,19 +3,42 @@
 #include <queue>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <limits>
 #include <unordered_map>
 #include <unordered_set>
 #include <set>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "trace.h"
+#include "stats.h"
+#include "csr_graph.h"
+#include "graph_gen.h"
+#include "arena.h"
+#include "huffman.h"
 using namespace std;
 struct Edge {
     int to;
     int weight;
 };
 using Graph = unordered_map<int, vector<Edge>>;
+// Per-run search state, carved from the run arena (arena.h).
+using NodeMap = pmr::unordered_map<int, int>;
+using MinHeap = priority_queue<pair<int,int>, pmr::vector<pair<int,int>>, greater<>>;
 static int STEP = 0;
-void printStep(const string& type, int a, int b, const string& explanation) {
+void printStep(string_view type, int a, int b, string_view explanation) {
+    if (!traceKeep(traceImportant(explanation))) return;
     // a is node or u, b is value or v depending on type
     cout << "{"
          << "\"step\":" << STEP++ << ","
@@ -27,34 +50,61 @@ void printStep(const string& type, int a, int b, const string& explanation) {
 }
 
 void printFinalPath(const vector<int>& path, int cost) {
-    ostringstream oss;
-    for (size_t i = 0; i < path.size(); ++i) {
-        oss << path[i];
-        if (i + 1 < path.size()) oss << "->";
-    }
     cout << "{"
          << "\"step\":" << STEP++ << ","
          << "\"type\":\"final\","
-         << "\"path\":\"" << oss.str() << "\","
+         << "\"path\":\"";
+    for (size_t i = 0; i < path.size(); ++i) {
+        cout << path[i];
+        if (i + 1 < path.size()) cout << "->";
+    }
+    cout << "\","
          << "\"cost\":" << cost << ","
          << "\"explanation\":\"Shortest path found with total cost " << cost << "\""
          << "}" << endl;
 }
 
 void printFinalMST(int cost, const vector<pair<int, int>>& edges) {
-    ostringstream oss;
-    for (const auto& [u, v] : edges) {
-        oss << "(" << u << "-" << v << ") ";
-    }
     cout << "{"
          << "\"step\":" << STEP++ << ","
          << "\"type\":\"final\","
-         << "\"mst\":\"" << oss.str() << "\","
+         << "\"mst\":\"";
+    for (const auto& [u, v] : edges) {
+        cout << "(" << u << "-" << v << ") ";
+    }
+    cout << "\","
          << "\"cost\":" << cost << ","
          << "\"explanation\":\"MST complete with total cost " << cost << "\""
          << "}" << endl;
 }
 
+// Keyframe for the seekable trace (trace.h): the label of every reached node
+// and the settled set, as {"<label>":{"node":value},"settled":[nodes]}.
+template <class Settled>
+string searchState(const char* label, const NodeMap& values, const Settled& settled) {
+    ostringstream out;
+    out << "{\"" << label << "\":{";
+    bool first = true;
+    for (auto& [n, v] : values) {
+        if (v == numeric_limits<int>::max()) continue;
+        out << (first ? "" : ",") << "\"" << n << "\":" << v;
+        first = false;
+    }
+    out << "},\"settled\":[";
+    first = true;
+    for (auto& entry : settled) {
+        if constexpr (is_same_v<decay_t<decltype(entry)>, int>) {
+            out << (first ? "" : ",") << entry;
+        } else {
+            if (!entry.second) continue;
+            out << (first ? "" : ",") << entry.first;
+        }
+        first = false;
+    }
+    out << "]}";
+    return out.str();
+}
+
 void printInit(const Graph& graph) {
     set<int> nodes;
     vector<tuple<int, int, int>> edges;
@@ -109,39 +159,45 @@ Graph buildDefaultGraph() {
 
 void runDijkstra(const Graph& graph, int start=0, int end=3) {
     printInit(graph);
-    unordered_map<int,int> dist, prev;
-    unordered_set<int> vis;
+    NodeMap dist(runMemory()), prev(runMemory());
+    pmr::unordered_set<int> vis(runMemory());
     for (auto& [n,_]: graph) dist[n] = numeric_limits<int>::max();
     dist[start] = 0;
-    priority_queue<pair<int,int>,vector<pair<int,int>>,greater<>> pq;
+    MinHeap pq{greater<>(), pmr::vector<pair<int,int>>(runMemory())};
     pq.push({0,start});
+    statAdd(Stat::HeapPushes);
 
     while (!pq.empty()) {
+        if (traceKeyframeDue()) traceKeyframe(searchState("dist", dist, vis));
         auto [d,u] = pq.top(); pq.pop();
+        statAdd(Stat::HeapPops);
         printStep("choose", u, d,
-                  "Choosing node "+to_string(u)+" with dist="+to_string(d));           
+                  stepText("Choosing node ", u, " with dist=", d));           
 
         if (d>dist[u]) {
-            printStep("skip",u,d,"Skipping stale entry for node "+to_string(u));   
+            printStep("skip",u,d,stepText("Skipping stale entry for node ", u));   
             continue;
         }
         if (vis.count(u)) {
-            printStep("skip",u,d,"Skipping already visited node "+to_string(u));   
+            printStep("skip",u,d,stepText("Skipping already visited node ", u));   
             continue;
         }
         vis.insert(u);
-        printStep("visit",u,d,"Visiting node "+to_string(u));        
+        printStep("visit",u,d,stepText("Visiting node ", u));        
 
         for (auto& e: graph.at(u)) {
             int v=e.to, w=e.weight;
             printStep("consider", u, v,
-                      "Considering edge "+to_string(u)+"->"+to_string(v)+" (w="+to_string(w)+")"); 
+                      stepText("Considering edge ", u, "->", v, " (w=", w, ")")); 
+            statAdd(Stat::Edges);
             if (dist[u]+w < dist[v]) {
                 dist[v]=dist[u]+w;
                 prev[v]=u;
                 pq.push({dist[v],v});
+                statAdd(Stat::Relaxations);
+                statAdd(Stat::HeapPushes);
                 printStep("update",v,dist[v],
-                          "Updated dist["+to_string(v)+"]="+to_string(dist[v]));    
+                          stepText("Updated dist[", v, "]=", dist[v]));    
             }
         }
     }
@@ -158,42 +214,476 @@ void runDijkstra(const Graph& graph, int start=0, int end=3) {
     printFinalPath(path, dist[end]);
 }
 
+// The Graph's edges in CSR form (see csr_graph.h); each undirected edge is
+// stored in both rows.
+void buildCsr(const Graph& graph, CsrGraph& g) {
+    EdgeList edges;
+    for (auto& [u,nbrs]: graph)
+        for (auto& e: nbrs)
+            if (u <= e.to) edges.add(u, e.to, e.weight);
+    g.build(move(edges), true);
+}
+
+class SpinBarrier {
+    const int count;
+    atomic<int> waiting{0};
+    atomic<unsigned> generation{0};
+
+public:
+    explicit SpinBarrier(int n) : count(n) {}
+    void wait() {
+        unsigned gen = generation.load(memory_order_acquire);
+        if (waiting.fetch_add(1, memory_order_acq_rel) + 1 == count) {
+            waiting.store(0, memory_order_relaxed);
+            generation.fetch_add(1, memory_order_release);
+        } else {
+            while (generation.load(memory_order_acquire) == gen) this_thread::yield();
+        }
+    }
+};
+
+const long long UNREACHED = numeric_limits<long long>::max();
+const long long MAX_BUCKETS = 1 << 16;   // live buckets kept in the cyclic bucket array
+const int DELTA_TRACE_NODES = 64;        // larger graphs run without per-node steps
+
+// Meyer and Sanders pick delta ~ maxWeight / degree: light edges then cause a
+// constant expected number of re-relaxations per vertex, while buckets stay
+// wide enough to give each phase a large frontier.
+long long autoDelta(const CsrGraph& g) {
+    if (g.m == 0) return 1;
+    double degree = max(1.0, (double)g.m / g.size());
+    return max(1LL, (long long)(g.maxWeight() / degree));
+}
+
+struct DeltaResult {
+    vector<long long> dist;
+    long long delta = 1, buckets = 0, phases = 0, relaxations = 0, edges = 0;
+};
+
+// Bucketed SSSP. Bucket k holds vertices with dist in [k*delta, (k+1)*delta).
+// The current bucket is emptied in phases that relax light edges in parallel,
+// re-queueing vertices whose distance dropped back into it; once it stays
+// empty its settled vertices relax their heavy edges once, into later buckets.
+// Distances only decrease through a CAS loop, so threads never lose an update.
+// Every pending distance is below (current + 1) * delta + maxWeight, so the
+// buckets wrap around an array of maxWeight / delta + 3 slots; each thread
+// keeps a heap of the buckets it has filled to find the next one quickly.
+DeltaResult deltaStepping(const CsrGraph& g, int source, long long delta, int threads, bool trace) {
+    int n = g.size();
+    long long maxWeight = g.maxWeight();
+    if (delta <= 0) delta = autoDelta(g);
+    delta = max(delta, maxWeight / MAX_BUCKETS + 1);
+    long long slots = maxWeight / delta + 3;
+    if (trace) threads = 1;
+
+    unique_ptr<atomic<long long>[]> dist(new atomic<long long>[n]);
+    unique_ptr<atomic<bool>[]> inBucket(new atomic<bool>[n]);
+    vector<long long> lightEnd(n);
+    for (int i = 0; i < n; ++i) {
+        dist[i].store(UNREACHED, memory_order_relaxed);
+        inBucket[i].store(false, memory_order_relaxed);
+    }
+    vector<vector<vector<int>>> bins(threads, vector<vector<int>>(slots));
+    vector<vector<int>> settled(threads);
+    vector<priority_queue<long long, vector<long long>, greater<>>> pending(threads);
+    vector<int> frontier;
+    mutex frontierLock;
+    atomic<size_t> nextChunk{0};
+    atomic<long long> nextBucket{UNREACHED};
+    vector<long long> relaxations(threads), edges(threads);
+    long long current = 0, buckets = 1, phases = 0;
+    bool done = false;
+    SpinBarrier barrier(threads);
+    const size_t CHUNK = 64;
+
+    dist[source].store(0);
+    bins[0][0].push_back(source);
+    pending[0].push(0);
+
+    auto worker = [&](int t) {
+        long long relaxed = 0, scanned = 0;
+        auto relax = [&](int u, long long begin, long long end) {
+            long long du = dist[u].load(memory_order_relaxed);
+            scanned += end - begin;
+            for (long long e = begin; e < end; ++e) {
+                int v = g.targets[e];
+                long long nd = du + g.weights[e];
+                long long old = dist[v].load(memory_order_relaxed);
+                while (nd < old && !dist[v].compare_exchange_weak(old, nd, memory_order_relaxed)) {}
+                if (nd >= old) continue;
+                ++relaxed;
+                auto& bin = bins[t][nd / delta % slots];
+                if (bin.empty()) pending[t].push(nd / delta);
+                bin.push_back(v);
+                if (trace) printStep("update", g.ids[v], (int)nd,
+                                     "Updated dist["+to_string(g.ids[v])+"]="+to_string(nd)+" (bucket "+to_string(nd / delta)+")");
+            }
+        };
+
+        for (int u = (int)((long long)n * t / threads); u < (int)((long long)n * (t + 1) / threads); ++u)
+            lightEnd[u] = upper_bound(g.weights + g.offsets[u], g.weights + g.offsets[u+1], delta) - g.weights;
+        barrier.wait();
+
+        while (true) {
+            auto& mine = bins[t][current % slots];
+            if (!mine.empty()) {
+                lock_guard<mutex> lock(frontierLock);
+                frontier.insert(frontier.end(), mine.begin(), mine.end());
+            }
+            mine.clear();
+            while (!pending[t].empty() && pending[t].top() == current) pending[t].pop();
+            barrier.wait();
+
+            if (frontier.empty()) {
+                for (int u: settled[t]) {
+                    relax(u, lightEnd[u], g.offsets[u+1]);
+                    inBucket[u].store(false, memory_order_relaxed);
+                }
+                settled[t].clear();
+                if (!pending[t].empty()) {
+                    long long mineNext = pending[t].top(), seen = nextBucket.load();
+                    while (mineNext < seen && !nextBucket.compare_exchange_weak(seen, mineNext)) {}
+                }
+                barrier.wait();
+                if (t == 0) {
+                    done = nextBucket.load() == UNREACHED;
+                    if (!done) {
+                        current = nextBucket.load();
+                        ++buckets;
+                    }
+                    nextBucket.store(UNREACHED);
+                }
+                barrier.wait();
+                if (done) break;
+                continue;
+            }
+
+            for (size_t i; (i = nextChunk.fetch_add(CHUNK)) < frontier.size();) {
+                for (size_t j = i; j < min(i + CHUNK, frontier.size()); ++j) {
+                    int u = frontier[j];
+                    if (dist[u].load(memory_order_relaxed) / delta != current) continue;   // moved to an earlier bucket
+                    if (!inBucket[u].exchange(true, memory_order_relaxed)) {
+                        settled[t].push_back(u);
+                        if (trace) printStep("visit", g.ids[u], (int)dist[u].load(),
+                                             "Visiting node "+to_string(g.ids[u])+" in bucket "+to_string(current));
+                    }
+                    relax(u, g.offsets[u], lightEnd[u]);
+                }
+            }
+            barrier.wait();
+            if (t == 0) {
+                frontier.clear();
+                nextChunk.store(0);
+                ++phases;
+            }
+            barrier.wait();
+        }
+        relaxations[t] = relaxed;
+        edges[t] = scanned;
+    };
+
+    vector<thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(worker, t);
+    worker(0);
+    for (auto& th: pool) th.join();
+
+    DeltaResult result;
+    result.delta = delta;
+    result.buckets = buckets;
+    result.phases = phases;
+    for (int t = 0; t < threads; ++t) {
+        result.relaxations += relaxations[t];
+        result.edges += edges[t];
+    }
+    result.dist.resize(n);
+    for (int i = 0; i < n; ++i) result.dist[i] = dist[i].load();
+    return result;
+}
+
+// Depth-first walk back from t along tight edges (dist[u] + w == dist[v]) of
+// an undirected graph. Without zero-weight edges it never backtracks.
+vector<int> tightPath(const CsrGraph& g, const vector<long long>& dist, int s, int t) {
+    vector<long long> next(g.size(), -1);       // next arc to try; -1 = not on the walk yet
+    vector<int> walk = {t};
+    next[t] = g.offsets[t];
+    while (walk.back() != s) {
+        int v = walk.back(), u = -1;
+        while (next[v] < g.offsets[v+1] && u < 0) {
+            long long e = next[v]++;
+            int c = g.targets[e];
+            if (next[c] < 0 && dist[c] != UNREACHED && dist[c] + g.weights[e] == dist[v]) u = c;
+        }
+        if (u < 0) {
+            walk.pop_back();
+            continue;
+        }
+        next[u] = g.offsets[u];
+        walk.push_back(u);
+    }
+    vector<int> path;
+    for (auto it = walk.rbegin(); it != walk.rend(); ++it) path.push_back(g.ids[*it]);
+    return path;
+}
+
+void printShortestPath(const CsrGraph& g, const vector<long long>& dist, int s, int t, int end) {
+    if (t < 0 || dist[t] == UNREACHED) {
+        cout << "{\"step\":"<<STEP++<<",\"type\":\"final\",\"explanation\":\"No path to node "<<end<<"\"}"<<endl;
+    } else if (g.undirected()) {
+        printFinalPath(tightPath(g, dist, s, t), (int)dist[t]);
+    } else {
+        cout << "{\"step\":"<<STEP++<<",\"type\":\"final\",\"cost\":"<<dist[t]
+             << ",\"explanation\":\"Shortest path found with total cost "<<dist[t]<<"\"}"<<endl;
+    }
+}
+
+// Drop-in for runDijkstra on large graphs: the same distances and final step,
+// computed by parallel delta-stepping. delta <= 0 selects it automatically.
+void runDeltaStepping(const CsrGraph& g, long long delta, int threads, int start, int end, bool trace) {
+    int s = g.index(start), t = g.index(end);
+    if (s < 0) {
+        cout << "{\"step\":"<<STEP++<<",\"type\":\"final\",\"explanation\":\"Error: start node "<<start<<" is not in the graph\"}"<<endl;
+        return;
+    }
+    if (any_of(g.weights, g.weights + g.m, [](int w){ return w < 0; })) {
+        cout << "{\"step\":"<<STEP++<<",\"type\":\"final\",\"explanation\":\"Error: negative edge weight\"}"<<endl;
+        return;
+    }
+
+    DeltaResult r;
+    {
+        ScopedTimer timer("compute");
+        r = deltaStepping(g, s, delta, threads, trace);
+    }
+    ScopedTimer timer("output");
+    statAdd(Stat::Relaxations, r.relaxations);
+    statAdd(Stat::Edges, r.edges);
+    long long reached = count_if(r.dist.begin(), r.dist.end(), [](long long d){ return d != UNREACHED; });
+    printStep("summary", (int)r.delta, (int)r.buckets,
+              stepText("Delta-stepping complete: delta=", r.delta, ", ", r.buckets, " buckets, ",
+                       r.phases, " light phases, reached ", reached, " of ", g.size(), " nodes"));
+    printShortestPath(g, r.dist, s, t, end);
+}
+
+void runDeltaStepping(const Graph& graph, long long delta, int threads, int start=0, int end=3) {
+    CsrGraph g;
+    {
+        ScopedTimer timer("build-csr");
+        buildCsr(graph, g);
+    }
+    bool trace = g.size() <= DELTA_TRACE_NODES;
+    if (trace) printInit(graph);
+    runDeltaStepping(g, delta, threads, start, end, trace);
+}
+
+// Untraced versions of the three algorithms for graphs loaded from a CSR file.
+vector<long long> dijkstraCsr(const CsrGraph& g, int s) {
+    vector<long long> dist(g.size(), UNREACHED);
+    priority_queue<pair<long long,int>,vector<pair<long long,int>>,greater<>> pq;
+    dist[s] = 0;
+    pq.push({0,s});
+    statAdd(Stat::HeapPushes);
+    while (!pq.empty()) {
+        auto [d,u] = pq.top(); pq.pop();
+        statAdd(Stat::HeapPops);
+        if (d > dist[u]) continue;
+        statAdd(Stat::Edges, g.offsets[u+1] - g.offsets[u]);
+        for (long long e = g.offsets[u]; e < g.offsets[u+1]; ++e) {
+            int v = g.targets[e];
+            if (d + g.weights[e] < dist[v]) {
+                dist[v] = d + g.weights[e];
+                pq.push({dist[v],v});
+                statAdd(Stat::Relaxations);
+                statAdd(Stat::HeapPushes);
+            }
+        }
+    }
+    return dist;
+}
+
+// Minimum spanning forest: Prim restarted from every node not yet reached.
+pair<long long,long long> primCsr(const CsrGraph& g) {
+    vector<long long> key(g.size(), UNREACHED);
+    vector<char> inMST(g.size(), 0);
+    priority_queue<pair<long long,int>,vector<pair<long long,int>>,greater<>> pq;
+    long long total = 0, edges = 0;
+    for (int root = 0; root < g.size(); ++root) {
+        if (inMST[root]) continue;
+        key[root] = 0;
+        pq.push({0,root});
+        statAdd(Stat::HeapPushes);
+        while (!pq.empty()) {
+            auto [cost,u] = pq.top(); pq.pop();
+            statAdd(Stat::HeapPops);
+            if (inMST[u]) continue;
+            inMST[u] = 1;
+            total += cost;
+            if (u != root) ++edges;
+            statAdd(Stat::Edges, g.offsets[u+1] - g.offsets[u]);
+            for (long long e = g.offsets[u]; e < g.offsets[u+1]; ++e) {
+                int v = g.targets[e], w = g.weights[e];
+                if (!inMST[v] && w < key[v]) {
+                    key[v] = w;
+                    pq.push({w,v});
+                    statAdd(Stat::Relaxations);
+                    statAdd(Stat::HeapPushes);
+                }
+            }
+        }
+    }
+    return {total, edges};
+}
+
+pair<long long,long long> kruskalCsr(const CsrGraph& g) {
+    vector<tuple<int,int,int>> edges;
+    for (int u = 0; u < g.size(); ++u)
+        for (long long e = g.offsets[u]; e < g.offsets[u+1]; ++e)
+            if (u < g.targets[e]) edges.emplace_back(g.weights[e], u, g.targets[e]);
+    {
+        ScopedTimer timer("sort-edges");
+        sort(edges.begin(), edges.end());
+    }
+    vector<int> parent(g.size()), rank(g.size(), 0);
+    for (int i = 0; i < g.size(); ++i) parent[i] = i;
+    auto find = [&](int x) {
+        while (parent[x] != x) x = parent[x] = parent[parent[x]];
+        return x;
+    };
+    long long total = 0, taken = 0;
+    statAdd(Stat::Edges, edges.size());
+    for (auto& [w,u,v]: edges) {
+        int a = find(u), b = find(v);
+        if (a == b) continue;
+        if (rank[a] < rank[b]) swap(a,b);
+        parent[b] = a;
+        if (rank[a] == rank[b]) ++rank[a];
+        total += w;
+        ++taken;
+    }
+    return {total, taken};
+}
+
+void printFinalForest(long long cost, long long edges) {
+    cout << "{\"step\":"<<STEP++<<",\"type\":\"final\",\"cost\":"<<cost<<",\"edges\":"<<edges
+         << ",\"explanation\":\"MST complete with total cost "<<cost<<" ("<<edges<<" edges)\"}"<<endl;
+}
+
+// <algo> file <graph.csr> [start [end]]: runs on a mapped CSR file, so the
+// cost of loading does not grow with the graph.
+int runGraphFile(const string& algo, const string& path, long long delta, int threads, int start, int end) {
+    CsrGraph g;
+    string error;
+    {
+        ScopedTimer timer("load");
+        error = g.load(path);
+    }
+    if (error.empty() && (algo=="prims"||algo=="kruskal") && !g.undirected()) error = "MST needs an undirected graph";
+    if (!error.empty()) {
+        cerr << "{\"type\":\"error\",\"message\":\""<<error<<"\"}"<<endl;
+        return 1;
+    }
+    if (algo=="delta-stepping") {
+        runDeltaStepping(g, delta, threads, start, end, false);
+    } else if (algo=="dijkstra") {
+        int s = g.index(start);
+        if (s < 0) {
+            cout << "{\"step\":"<<STEP++<<",\"type\":\"final\",\"explanation\":\"Error: start node "<<start<<" is not in the graph\"}"<<endl;
+            return 0;
+        }
+        vector<long long> dist;
+        {
+            ScopedTimer timer("compute");
+            dist = dijkstraCsr(g, s);
+        }
+        ScopedTimer timer("output");
+        printShortestPath(g, dist, s, g.index(end), end);
+    } else if (algo=="prims"||algo=="kruskal") {
+        pair<long long,long long> forest;
+        {
+            ScopedTimer timer("compute");
+            forest = algo=="prims" ? primCsr(g) : kruskalCsr(g);
+        }
+        ScopedTimer timer("output");
+        printFinalForest(forest.first, forest.second);
+    } else {
+        cerr << "{\"type\":\"error\",\"message\":\"Unknown algorithm: "<<algo<<"\"}"<<endl;
+        return 1;
+    }
+    return 0;
+}
+
+// convert <edges.txt|-> <graph.csr> [directed]: edge list text to a CSR file.
+int runConvert(int argc, char* argv[]) {
+    if (argc < 4) {
+        cerr << "{\"type\":\"error\",\"message\":\"Usage: convert <edges.txt|-> <graph.csr> [directed]\"}"<<endl;
+        return 1;
+    }
+    EdgeList edges;
+    CsrGraph g;
+    string error;
+    {
+        ScopedTimer timer("parse");
+        error = readEdgeList(argv[2], edges);
+    }
+    if (error.empty()) {
+        ScopedTimer timer("build");
+        g.build(move(edges), !(argc > 4 && string(argv[4])=="directed"));
+    }
+    if (error.empty()) {
+        ScopedTimer timer("write");
+        if (!g.save(argv[3])) error = string("Cannot write ") + argv[3];
+    }
+    if (!error.empty()) {
+        cerr << "{\"type\":\"error\",\"message\":\""<<error<<"\"}"<<endl;
+        return 1;
+    }
+    cout << "{\"step\":"<<STEP++<<",\"type\":\"final\",\"nodes\":"<<g.n<<",\"arcs\":"<<g.m
+         << ",\"bytes\":"<<graphLayoutFor(g.n, g.m, g.flags).fileSize
+         << ",\"explanation\":\"Converted "<<g.n<<" nodes and "<<g.m<<" arcs\"}"<<endl;
+    return 0;
+}
+
 void runPrims(const Graph& graph, int start=0) {
     printInit(graph);
-    unordered_map<int,bool> inMST;
-    unordered_map<int,int> key,parent;
+    pmr::unordered_map<int,bool> inMST(runMemory());
+    NodeMap key(runMemory()), parent(runMemory());
     for (auto& [n,_]: graph) key[n]=numeric_limits<int>::max();
     key[start]=0;
-    priority_queue<pair<int,int>,vector<pair<int,int>>,greater<>> pq;
+    MinHeap pq{greater<>(), pmr::vector<pair<int,int>>(runMemory())};
     pq.push({0,start});
+    statAdd(Stat::HeapPushes);
     vector<pair<int,int>> mst;
     int total=0;
 
     while(!pq.empty()) {
+        if (traceKeyframeDue()) traceKeyframe(searchState("key", key, inMST));
         auto [cost,u] = pq.top(); pq.pop();
+        statAdd(Stat::HeapPops);
         printStep("choose", u, cost,
-                  "Choosing node "+to_string(u)+" with key="+to_string(cost));    
+                  stepText("Choosing node ", u, " with key=", cost));    
 
         if (inMST[u]) {
-            printStep("skip",u,cost,"Skipping node already in MST "+to_string(u)); 
+            printStep("skip",u,cost,stepText("Skipping node already in MST ", u)); 
             continue;
         }
         inMST[u]=true;
         total+=cost;
         if (u!=start) mst.emplace_back(parent[u],u);
         printStep("include",u,cost,
-                  "Include node "+to_string(u)+" with connecting cost="+to_string(cost)); 
+                  stepText("Include node ", u, " with connecting cost=", cost)); 
 
         for (auto& e: graph.at(u)) {
             int v=e.to, w=e.weight;
             printStep("consider",u,v,
-                      "Considering edge "+to_string(u)+"->"+to_string(v)+" (w="+to_string(w)+")"); 
+                      stepText("Considering edge ", u, "->", v, " (w=", w, ")")); 
+            statAdd(Stat::Edges);
             if (!inMST[v] && w<key[v]) {
                 key[v]=w;
                 parent[v]=u;
                 pq.push({w,v});
+                statAdd(Stat::Relaxations);
+                statAdd(Stat::HeapPushes);
                 printStep("update",v,w,
-                          "Update key["+to_string(v)+"]="+to_string(w));              
+                          stepText("Update key[", v, "]=", w));              
             }
         }
     }
@@ -225,8 +715,11 @@ void runKruskal(const Graph& graph) {
       for (auto& e: nbrs)
         if (u<e.to) edges.emplace_back(e.weight,u,e.to);
 
-    sort(edges.begin(), edges.end(),
-         [](auto &a, auto &b){ return get<0>(a) < get<0>(b); });
+    {
+        ScopedTimer timer("sort-edges");
+        sort(edges.begin(), edges.end(),
+             [](auto &a, auto &b){ statAdd(Stat::Comparisons); return get<0>(a) < get<0>(b); });
+    }
 
     DSU dsu;
     for (auto& [u,_]: graph) dsu.makeSet(u);
@@ -234,25 +727,333 @@ void runKruskal(const Graph& graph) {
     vector<pair<int,int>> mst;
     int total=0;
     for (auto& [w,u,v]: edges) {
+        if (traceKeyframeDue()) {
+            ostringstream state;
+            state << "{\"cost\":" << total << ",\"mst\":[";
+            for (size_t i = 0; i < mst.size(); ++i) state << (i ? "," : "") << "[" << mst[i].first << "," << mst[i].second << "]";
+            state << "]}";
+            traceKeyframe(state.str());
+        }
+        statAdd(Stat::Edges);
         printStep("consider", u, v,
-                  "Considering edge "+to_string(u)+"-"+to_string(v)
-                  +" (w="+to_string(w)+")");                          
+                  stepText("Considering edge ", u, "-", v, " (w=", w, ")"));                          
         if (!dsu.unionSet(u,v)) {
             printStep("skip",u,v,
-                      "Skipping edge "+to_string(u)+"-"+to_string(v)
-                      +" (would form cycle)");                        
+                      stepText("Skipping edge ", u, "-", v, " (would form cycle)"));                        
             continue;
         }
         total+=w;
         mst.emplace_back(u,v);
         printStep("include",u,w,
-                  "Kruskal: include edge "+to_string(u)+"-"+to_string(v)
-                  +" (w="+to_string(w)+")");                           
+                  stepText("Kruskal: include edge ", u, "-", v, " (w=", w, ")"));                           
     }
 
     printFinalMST(total, mst);
 }
 
+// A byte as the explanations show it: the character when printable (and not
+// a quote or backslash, which would need escaping), else its value.
+string symbolName(int s) {
+    if (s > ' ' && s < 127 && s != '"' && s != '\\') return string("'") + (char)s + "'";
+    return "byte " + to_string(s);
+}
+
+// Huffman coding of a short text, step by step: the byte counts, each merge
+// of the two lightest nodes (symbols are nodes 0-255, merged nodes 256 on),
+// any length limiting, then each symbol's canonical code.
+void runHuffman(const string& text) {
+    ByteHistogram counts{};
+    for (unsigned char c : text) ++counts[c];
+    for (int s = 0; s < 256; ++s)
+        if (counts[s]) printStep("count", s, counts[s], stepText("Symbol ", symbolName(s), " occurs ", counts[s], " times"));
+
+    vector<HuffmanMerge> merges;
+    CodeLengths lengths = huffmanLengths(counts, &merges);
+    for (const HuffmanMerge& m : merges) {
+        statAdd(Stat::Nodes);
+        printStep("merge", m.left, m.right,
+                  stepText("Merging nodes ", m.left, " and ", m.right, " into node ", m.node, " (weight ", m.weight, ")"));
+    }
+    if (limitHuffmanLengths(lengths, counts))
+        printStep("limit", HUFFMAN_MAX_BITS, 0, stepText("Limiting code lengths to ", HUFFMAN_MAX_BITS, " bits"));
+
+    HuffmanCodes codes = canonicalCodes(lengths);
+    uint64_t bits = 0;
+    for (int s = 0; s < 256; ++s) {
+        if (!lengths[s]) continue;
+        string code;
+        for (int b = 0; b < lengths[s]; ++b) code += (codes.bits[s] >> b) & 1 ? '1' : '0';
+        bits += counts[s] * lengths[s];
+        printStep("code", s, lengths[s], stepText("Symbol ", symbolName(s), " gets code ", code, " (", (int)lengths[s], " bits)"));
+    }
+    cout << "{\"step\":"<<STEP++<<",\"type\":\"final\",\"bytes\":"<<text.size()<<",\"bits\":"<<bits
+         << ",\"explanation\":\"Encoded "<<text.size()<<" bytes into "<<bits<<" bits\"}"<<endl;
+}
+
+double megabytesPerSecond(uint64_t bytes, double ms) {
+    return ms > 0 ? bytes / 1e6 / (ms / 1e3) : 0;
+}
+
+bool sameFiles(const string& a, const string& b) {
+    FilePtr fa(fopen(a.c_str(), "rb")), fb(fopen(b.c_str(), "rb"));
+    if (!fa || !fb) return false;
+    vector<char> bufA(HUFFMAN_CHUNK), bufB(HUFFMAN_CHUNK);
+    for (;;) {
+        size_t gotA = fread(bufA.data(), 1, bufA.size(), fa.get()), gotB = fread(bufB.data(), 1, bufB.size(), fb.get());
+        if (gotA != gotB || memcmp(bufA.data(), bufB.data(), gotA) != 0) return false;
+        if (gotA == 0) return true;
+    }
+}
+
+// huffman file <input> [output]: compresses input to output (input.huf by
+// default), decompresses it again to check the round trip, and reports both
+// throughputs. huffman decode <input.huf> <output> only decompresses.
+int runHuffmanFile(int argc, char* argv[]) {
+    string mode = argv[2];
+    if (argc < 4 || (mode == "decode" && argc < 5)) {
+        cerr << "{\"type\":\"error\",\"message\":\"Usage: huffman file <input> [output] | huffman decode <input.huf> <output>\"}"<<endl;
+        return 1;
+    }
+    string input = argv[3], output = argc > 4 ? argv[4] : input + ".huf";
+    // Encoding opens the output before reading the input a second time, and
+    // file mode also writes <output>.check.
+    error_code ec;
+    if (filesystem::equivalent(input, output, ec) || filesystem::equivalent(input, output + ".check", ec)) {
+        cerr << "{\"type\":\"error\",\"message\":\"The output file must not be the input file\"}"<<endl;
+        return 1;
+    }
+    string error;
+    if (mode == "decode") {
+        uint64_t size = 0;
+        auto start = chrono::steady_clock::now();
+        {
+            ScopedTimer timer("decode");
+            error = huffmanDecodeFile(input, output, size);
+        }
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (!error.empty()) {
+            cerr << "{\"type\":\"error\",\"message\":\""<<error<<"\"}"<<endl;
+            return 1;
+        }
+        cout << "{\"step\":"<<STEP++<<",\"type\":\"final\",\"outputBytes\":"<<size<<",\"decodeMBps\":"<<megabytesPerSecond(size, ms)
+             << ",\"explanation\":\"Decoded "<<size<<" bytes\"}"<<endl;
+        return 0;
+    }
+
+    ByteHistogram counts;
+    uint64_t size = 0, written = 0, decoded = 0;
+    auto elapsed = [](auto start) { return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count(); };
+    auto start = chrono::steady_clock::now();
+    {
+        ScopedTimer timer("histogram");
+        error = huffmanHistogram(input, counts, size);
+    }
+    HuffmanCodes codes;
+    if (error.empty()) {
+        CodeLengths lengths = huffmanLengths(counts);
+        limitHuffmanLengths(lengths, counts);
+        codes = canonicalCodes(lengths);
+        ScopedTimer timer("encode");
+        error = huffmanEncodeFile(input, output, codes, size, written);
+    }
+    double encodeMs = elapsed(start);
+    string check = output + ".check";
+    double decodeMs = 0;
+    if (error.empty()) {
+        start = chrono::steady_clock::now();
+        ScopedTimer timer("decode");
+        error = huffmanDecodeFile(output, check, decoded);
+        decodeMs = elapsed(start);
+    }
+    bool verified = false;
+    if (error.empty()) {
+        ScopedTimer timer("verify");
+        verified = decoded == size && sameFiles(input, check);
+    }
+    remove(check.c_str());
+    if (!error.empty()) {
+        cerr << "{\"type\":\"error\",\"message\":\""<<error<<"\"}"<<endl;
+        return 1;
+    }
+    cout << "{\"step\":"<<STEP++<<",\"type\":\"final\",\"inputBytes\":"<<size<<",\"outputBytes\":"<<written
+         << ",\"ratio\":"<<(size ? (double)written / size : 0)
+         << ",\"encodeMBps\":"<<megabytesPerSecond(size, encodeMs)<<",\"decodeMBps\":"<<megabytesPerSecond(size, decodeMs)
+         << ",\"verified\":"<<(verified ? "true" : "false")
+         << ",\"explanation\":\"Compressed "<<size<<" bytes to "<<written<<" bytes\"}"<<endl;
+    return verified ? 0 : 1;
+}
+
+// generate <kind> <nodes> <graph.csr> [degree [weights [maxWeight [seed]]]]
+int runGenerate(int argc, char* argv[]) {
+    if (argc < 5) {
+        cerr << "{\"type\":\"error\",\"message\":\"Usage: generate <rmat|er|grid|complete> <nodes> <graph.csr> [degree [weights [maxWeight [seed]]]]\"}"<<endl;
+        return 1;
+    }
+    int degree = argc > 5 ? stoi(argv[5]) : 16;
+    WeightGen weight;
+    if (argc > 6) weight.kind = argv[6];
+    if (argc > 7) weight.maxWeight = stoi(argv[7]);
+    uint64_t seed = argc > 8 ? stoull(argv[8]) : 1;
+    EdgeList edges;
+    string error;
+    {
+        ScopedTimer timer("generate");
+        error = generateGraph(argv[2], stoll(argv[3]), degree, weight, seed, edges);
+    }
+    CsrGraph g;
+    if (error.empty()) {
+        ScopedTimer timer("build");
+        g.build(move(edges), true);
+    }
+    if (error.empty()) {
+        ScopedTimer timer("write");
+        if (!g.save(argv[4])) error = string("Cannot write ") + argv[4];
+    }
+    if (!error.empty()) {
+        cerr << "{\"type\":\"error\",\"message\":\""<<error<<"\"}"<<endl;
+        return 1;
+    }
+    cout << "{\"step\":"<<STEP++<<",\"type\":\"final\",\"nodes\":"<<g.n<<",\"edges\":"<<g.m/2
+         << ",\"explanation\":\"Generated "<<argv[2]<<" graph with "<<g.n<<" nodes and "<<g.m/2<<" edges\"}"<<endl;
+    return 0;
+}
+
+// Raw text of a top-level value in a flat JSON record ("" when absent);
+// objects are returned whole.
+string jsonValue(const string& line, const string& key) {
+    size_t at = line.find("\"" + key + "\":");
+    if (at == string::npos) return "";
+    size_t from = at + key.size() + 3, to = from;
+    if (line[from] == '{') {
+        for (int depth = 0; to < line.size(); ++to) {
+            if (line[to] == '{') ++depth;
+            if (line[to] == '}' && --depth == 0) break;
+        }
+        return line.substr(from, to + 1 - from);
+    }
+    while (to < line.size() && line[to] != ',' && line[to] != '}') ++to;
+    return line.substr(from, to - from);
+}
+
+vector<string> splitList(const string& text) {
+    vector<string> out;
+    stringstream ss(text);
+    for (string item; getline(ss, item, ',');)
+        if (!item.empty()) out.push_back(item);
+    return out;
+}
+
+// The bench child running and the temporary graph file, for stopBench: the
+// server stops a run with SIGTERM, and neither may outlive it.
+volatile sig_atomic_t benchChild = 0;
+char benchFile[4096];
+
+extern "C" void stopBench(int sig) {
+    if (benchChild > 0) kill(benchChild, SIGTERM);
+    unlink(benchFile);
+    _exit(128 + sig);
+}
+
+// Runs args[0] with args, reading its standard output line by line.
+template <typename OnLine>
+void runChild(const vector<string>& args, OnLine onLine) {
+    vector<char*> argv;
+    for (const string& a: args) argv.push_back(const_cast<char*>(a.c_str()));
+    argv.push_back(nullptr);
+    int out[2];
+    if (pipe(out) != 0) return;
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(out[1], STDOUT_FILENO);
+        close(out[0]);
+        close(out[1]);
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+    close(out[1]);
+    if (pid < 0) {
+        close(out[0]);
+        return;
+    }
+    benchChild = pid;
+    if (FILE* child = fdopen(out[0], "r")) {
+        char buf[4096];
+        while (fgets(buf, sizeof buf, child)) onLine(buf);
+        fclose(child);
+    } else {
+        close(out[0]);
+    }
+    waitpid(pid, nullptr, 0);
+    benchChild = 0;
+}
+
+// bench [kinds] [sizes] [degree [weights [maxWeight [seed]]]]
+// For each graph kind and node count, generates a graph into a temporary CSR
+// file and runs every algorithm on it in a fresh process of this binary, so
+// peak RSS and the load / compute / output phases are per algorithm. Reports
+// edges per second of compute time.
+int runBench(int argc, char* argv[]) {
+    vector<string> kinds = splitList(argc > 2 ? argv[2] : "rmat,er,grid");
+    vector<string> sizes = splitList(argc > 3 ? argv[3] : "16384,65536,262144,1048576");
+    int degree = argc > 4 ? stoi(argv[4]) : 16;
+    WeightGen weight;
+    if (argc > 5) weight.kind = argv[5];
+    if (argc > 6) weight.maxWeight = stoi(argv[6]);
+    uint64_t seed = argc > 7 ? stoull(argv[7]) : 1;
+    string self = argv[0];
+    string file = (filesystem::temp_directory_path() / ("greedy-bench-" + to_string(seed) + "-"
+                   + to_string(chrono::steady_clock::now().time_since_epoch().count()) + ".csr")).string();
+    snprintf(benchFile, sizeof benchFile, "%s", file.c_str());
+    signal(SIGTERM, stopBench);
+    signal(SIGINT, stopBench);
+
+    for (const string& kind: kinds) {
+        for (const string& size: sizes) {
+            long long nodes = 0, edges = 0;
+            int start = 0, end = 0;
+            string error;
+            auto began = chrono::steady_clock::now();
+            {
+                EdgeList list;
+                error = generateGraph(kind, stoll(size), degree, weight, seed, list);
+                CsrGraph g;
+                if (error.empty()) g.build(move(list), true);
+                if (error.empty() && !g.save(file)) error = "Cannot write " + file;
+                if (error.empty()) {
+                    nodes = g.n;
+                    edges = g.m / 2;
+                    start = g.ids[0];
+                    end = g.ids[g.n - 1];
+                }
+            }
+            if (!error.empty()) {
+                cerr << "{\"type\":\"error\",\"message\":\""<<error<<"\"}"<<endl;
+                continue;
+            }
+            double generateMs = chrono::duration<double, milli>(chrono::steady_clock::now() - began).count();
+
+            for (const char* algo: {"dijkstra", "delta-stepping", "prims", "kruskal"}) {
+                string stats;
+                runChild({self, algo, "file", file, to_string(start), to_string(end)}, [&](const char* line) {
+                    if (strncmp(line, "{\"type\":\"stats\"", 15) == 0) stats = line;
+                });
+                string phases = jsonValue(stats, "phases");
+                string compute = jsonValue(phases, "compute");
+                double seconds = compute.empty() ? 0 : stod(compute) / 1000;
+                cout << "{\"step\":"<<STEP++<<",\"type\":\"bench\",\"graph\":\""<<kind<<"\",\"nodes\":"<<nodes
+                     << ",\"edges\":"<<edges<<",\"algorithm\":\""<<algo<<"\",\"generateMs\":"<<generateMs
+                     << ",\"edgesPerSec\":"<<(seconds > 0 ? edges / seconds : 0)
+                     << ",\"maxRssKb\":"<<(stats.empty() ? "null" : jsonValue(stats, "maxRssKb"))
+                     << ",\"phases\":"<<(phases.empty() ? "null" : phases)<<"}"<<endl;
+            }
+        }
+    }
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    remove(file.c_str());
+    return 0;
+}
+
 void printEnd() {
     cout << "{\"step\":"<<STEP++<<",\"type\":\"end\"}" << endl;
 }
@@ -263,11 +1064,51 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     string algo=argv[1];
-    Graph graph = (argc==2||(argc==3&&string(argv[2])=="0"))
+    StatsReport report(algo);
+    RunArena arena;
+    if(algo=="convert") return runConvert(argc,argv);
+    if(algo=="generate") return runGenerate(argc,argv);
+    if(algo=="bench") return runBench(argc,argv);
+    if(algo=="huffman") {
+        if (argc > 2 && (string(argv[2])=="file" || string(argv[2])=="decode")) return runHuffmanFile(argc,argv);
+        string text;
+        for (int i = 2; i < argc; ++i) text += (i > 2 ? " " : "") + string(argv[i]);
+        runHuffman(argc > 2 ? text : "abracadabra");
+        printEnd();
+        return 0;
+    }
+
+    // Values before the "file" argument or the u v w triplets are options
+    // (delta-stepping: delta threads).
+    int fileArg = 0;
+    for (int i = 2; i < argc && !fileArg; ++i)
+        if (string(argv[i])=="file") fileArg = i;
+    int first = 2;
+    long long delta = 0;
+    int threads = max(1u, thread::hardware_concurrency());
+    if (algo=="delta-stepping") {
+        int options = fileArg ? fileArg - 2 : (argc - 2) % 3;
+        if (options > 0) delta = stoll(argv[2]);
+        if (options > 1) threads = max(1, stoi(argv[3]));
+        first += options;
+    }
+    if (fileArg) {
+        if (fileArg+1 >= argc) {
+            cerr << "{\"type\":\"error\",\"message\":\"Usage: <algo> file <graph.csr> [start [end]]\"}"<<endl;
+            return 1;
+        }
+        int start = fileArg+2 < argc ? stoi(argv[fileArg+2]) : 0;
+        int end = fileArg+3 < argc ? stoi(argv[fileArg+3]) : 3;
+        int status = runGraphFile(algo, argv[fileArg+1], delta, threads, start, end);
+        if (status == 0) printEnd();
+        return status;
+    }
+    Graph graph = (argc==first||(argc==first+1&&string(argv[first])=="0"))
                   ? buildDefaultGraph()
-                  : buildGraphFromArgs(argc,argv,2);
+                  : buildGraphFromArgs(argc,argv,first);
 
     if(algo=="dijkstra")     runDijkstra(graph,0,3);
+    else if(algo=="delta-stepping") runDeltaStepping(graph,delta,threads,0,3);
     else if(algo=="prims")   runPrims(graph);
     else if(algo=="kruskal") runKruskal(graph);
     else {
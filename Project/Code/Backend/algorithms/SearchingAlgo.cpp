@@ -2,9 +2,25 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include <chrono>
+#include <random>
+#include <climits>
+#include <cmath>
+#include <new>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+#include "trace.h"
+#include "stats.h"
 using namespace std;
+using namespace std::chrono;
+
+bool traceOn = true;
 
 void emitStep(const vector<int>& arr, const string& message, int left, int right, int mid) {
+    if (!traceOn || !traceKeep(traceImportant(message))) return;
     stringstream ss;
     ss << R"({"array":[)";
     for (int i = 0; i < arr.size(); ++i) {
@@ -16,31 +32,512 @@ void emitStep(const vector<int>& arr, const string& message, int left, int right
     cout.flush();
 }
 
+// Comparisons are only counted for traced runs: the benchmarks time this
+// loop and turn tracing off.
 int binarySearch(const vector<int>& arr, int left, int right, int target) {
     while (left <= right) {
         int mid = left + (right - left) / 2;
-        emitStep(arr, "Checking middle element", left, right, mid);
+        if (traceOn) {
+            statAdd(Stat::Comparisons);
+            emitStep(arr, "Checking middle element", left, right, mid);
+        }
 
         if (arr[mid] == target) {
-            emitStep(arr, "Target found", left, right, mid);
+            if (traceOn) emitStep(arr, "Target found", left, right, mid);
             return mid;
         }
         else if (arr[mid] < target) {
-            emitStep(arr, "Target is greater than middle element, searching right half", left, right, mid);
+            if (traceOn) emitStep(arr, "Target is greater than middle element, searching right half", left, right, mid);
             left = mid + 1;
         }
         else {
-            emitStep(arr, "Target is less than middle element, searching left half", left, right, mid);
+            if (traceOn) emitStep(arr, "Target is less than middle element, searching left half", left, right, mid);
             right = mid - 1;
         }
     }
-    emitStep(arr, "Target not found", left, right, -1);
+    if (traceOn) emitStep(arr, "Target not found", left, right, -1);
     return -1;
 }
 
+// Branchless lower_bound: the loop runs exactly ceil(log2 n) times for every
+// target and the comparison becomes a conditional move, so there is no
+// mispredicted branch per level. Returns the first index with arr[i] >= x.
+size_t lowerBoundBranchless(const int* arr, size_t n, int x) {
+    if (n == 0) return 0;
+    const int* base = arr;
+    for (size_t len = n; len > 1; ) {
+        size_t half = len / 2;
+        // Both possible next probes, so the load is in flight either way.
+        if (len >= 4) {
+            __builtin_prefetch(base + len / 4 - 1);
+            __builtin_prefetch(base + half + len / 4 - 1);
+        }
+        base += (base[half - 1] < x) * half;
+        len -= half;
+    }
+    return (base - arr) + (*base < x);
+}
+
+// 64-byte aligned int buffer, so layout blocks line up with cache lines.
+struct AlignedInts {
+    int* data = nullptr;
+    explicit AlignedInts(size_t count) : data(static_cast<int*>(::operator new[](count * sizeof(int), align_val_t(64)))) {}
+    ~AlignedInts() { ::operator delete[](data, align_val_t(64)); }
+    AlignedInts(const AlignedInts&) = delete;
+    AlignedInts& operator=(const AlignedInts&) = delete;
+};
+
+// Eytzinger (BFS-order) layout: node k has children 2k and 2k + 1, so the
+// first levels share a few cache lines and the 16 descendants four levels
+// down are one line that can be prefetched while the current level resolves.
+// Searches return the lower-bound key, INT_MAX when every key is smaller.
+class Eytzinger {
+    size_t n;
+    AlignedInts t;
+
+    size_t fill(const int* sorted, size_t i, size_t k) {
+        if (k <= n) {
+            i = fill(sorted, i, 2 * k);
+            t.data[k] = sorted[i++];
+            i = fill(sorted, i, 2 * k + 1);
+        }
+        return i;
+    }
+
+public:
+    Eytzinger(const int* sorted, size_t count) : n(count), t(count + 1) {
+        t.data[0] = INT_MAX;
+        fill(sorted, 0, 1);
+    }
+
+    int lowerBound(int x) const {
+        size_t k = 1;
+        while (k <= n) {
+            __builtin_prefetch(t.data + k * 16);
+            k = 2 * k + (t.data[k] < x);
+        }
+        k >>= __builtin_ffsll(~k);
+        return t.data[k];
+    }
+
+    // Interleaves `count` searches level by level; the levels above the last
+    // one are complete, so every query takes the same number of steps.
+    void lowerBoundBatch(const int* xs, int* out, int count) const {
+        size_t k[64];
+        int levels = 63 - __builtin_clzll(n + 1);
+        for (int q = 0; q < count; ++q) k[q] = 1;
+        for (int level = 0; level < levels; ++level) {
+            for (int q = 0; q < count; ++q) {
+                k[q] = 2 * k[q] + (t.data[k[q]] < xs[q]);
+                __builtin_prefetch(t.data + k[q] * 16);
+            }
+        }
+        for (int q = 0; q < count; ++q) {
+            if (k[q] <= n) k[q] = 2 * k[q] + (t.data[k[q]] < xs[q]);
+            k[q] >>= __builtin_ffsll(~k[q]);
+            out[q] = t.data[k[q]];
+        }
+    }
+};
+
+// Static B-tree (S-tree): 16 keys per 64-byte node and 17 children stored
+// implicitly at k * 17 + i + 1. A node is searched by comparing all 16 keys
+// with the target at once and counting the keys that are smaller.
+class STree {
+    static const int B = 16;
+    size_t blocks;
+    AlignedInts keys;
+
+    void fill(const int* sorted, size_t n, size_t& i, size_t k) {
+        if (k >= blocks) return;
+        for (int j = 0; j < B; ++j) {
+            fill(sorted, n, i, child(k, j));
+            keys.data[k * B + j] = i < n ? sorted[i++] : INT_MAX;
+        }
+        fill(sorted, n, i, child(k, B));
+    }
+
+    static size_t child(size_t k, int i) { return k * (B + 1) + i + 1; }
+
+    // Number of keys in node k smaller than x.
+    int rank(size_t k, int x) const {
+        const int* node = keys.data + k * B;
+#ifdef HAVE_X86_SIMD
+        __m128i target = _mm_set1_epi32(x);
+        unsigned mask = 0;
+        for (int j = 0; j < B; j += 4) {
+            __m128i lt = _mm_cmpgt_epi32(target, _mm_load_si128((const __m128i*)(node + j)));
+            mask |= (unsigned)_mm_movemask_ps(_mm_castsi128_ps(lt)) << j;
+        }
+        return __builtin_popcount(mask);
+#else
+        int r = 0;
+        for (int j = 0; j < B; ++j) r += node[j] < x;
+        return r;
+#endif
+    }
+
+public:
+    STree(const int* sorted, size_t n) : blocks((n + B - 1) / B), keys(max<size_t>(blocks, 1) * B) {
+        size_t i = 0;
+        fill(sorted, n, i, 0);
+    }
+
+    int lowerBound(int x) const {
+        int result = INT_MAX;
+        for (size_t k = 0; k < blocks; ) {
+            int i = rank(k, x);
+            if (i < B) result = keys.data[k * B + i];
+            k = child(k, i);
+        }
+        return result;
+    }
+
+    void lowerBoundBatch(const int* xs, int* out, int count) const {
+        size_t k[64];
+        for (int q = 0; q < count; ++q) {
+            k[q] = 0;
+            out[q] = INT_MAX;
+        }
+        for (bool active = true; active; ) {
+            active = false;
+            for (int q = 0; q < count; ++q) {
+                if (k[q] >= blocks) continue;
+                int i = rank(k[q], xs[q]);
+                if (i < B) out[q] = keys.data[k[q] * B + i];
+                k[q] = child(k[q], i);
+                if (k[q] < blocks) {
+                    __builtin_prefetch(keys.data + k[q] * B);
+                    active = true;
+                }
+            }
+        }
+    }
+};
+
+const int BATCH = 32;
+
+// Runs `search` over all queries and reports ns/query and how many targets
+// were present; every method must agree on the count.
+template <typename Search>
+void benchMethod(const string& method, size_t n, const vector<int>& queries, Search search) {
+    auto start = steady_clock::now();
+    long long found = search();
+    double ns = duration_cast<duration<double, nano>>(steady_clock::now() - start).count();
+    cout << R"({"action":"bench","method":")" << method << R"(","n":)" << n << R"(,"queries":)" << queries.size()
+         << R"(,"nsPerQuery":)" << ns / queries.size() << R"(,"found":)" << found << "}" << endl;
+}
+
+void benchmark(size_t n, size_t q) {
+    traceOn = false;
+    vector<int> arr(n);
+    for (size_t i = 0; i < n; ++i) arr[i] = (int)(i * 2);
+    vector<int> queries(q);
+    mt19937_64 rng(42);
+    for (int& x : queries) x = (int)(rng() % (2 * n));
+    vector<int> results(BATCH);
+
+    benchMethod("loop", n, queries, [&] {
+        long long found = 0;
+        for (int x : queries) found += binarySearch(arr, 0, (int)n - 1, x) >= 0;
+        return found;
+    });
+    benchMethod("branchless", n, queries, [&] {
+        long long found = 0;
+        for (int x : queries) {
+            size_t i = lowerBoundBranchless(arr.data(), n, x);
+            found += i < n && arr[i] == x;
+        }
+        return found;
+    });
+    {
+        Eytzinger eyt(arr.data(), n);
+        benchMethod("eytzinger", n, queries, [&] {
+            long long found = 0;
+            for (int x : queries) found += eyt.lowerBound(x) == x;
+            return found;
+        });
+        benchMethod("eytzinger-batch", n, queries, [&] {
+            long long found = 0;
+            for (size_t b = 0; b < q; b += BATCH) {
+                int count = min<size_t>(BATCH, q - b);
+                eyt.lowerBoundBatch(queries.data() + b, results.data(), count);
+                for (int j = 0; j < count; ++j) found += results[j] == queries[b + j];
+            }
+            return found;
+        });
+    }
+    {
+        STree tree(arr.data(), n);
+        benchMethod("s-tree", n, queries, [&] {
+            long long found = 0;
+            for (int x : queries) found += tree.lowerBound(x) == x;
+            return found;
+        });
+        benchMethod("s-tree-batch", n, queries, [&] {
+            long long found = 0;
+            for (size_t b = 0; b < q; b += BATCH) {
+                int count = min<size_t>(BATCH, q - b);
+                tree.lowerBoundBatch(queries.data() + b, results.data(), count);
+                for (int j = 0; j < count; ++j) found += results[j] == queries[b + j];
+            }
+            return found;
+        });
+    }
+    cout << R"({"action":"final"})" << endl;
+}
+
+// Adaptive index for sorted ints. A sample of the keys decides how far a
+// straight line through the whole array is from the real positions:
+//  - within SEQ_WINDOW: one interpolation probe, then a short sequential scan;
+//  - otherwise, if interpolation search converges in a few probes on the
+//    sample: interpolation search;
+//  - otherwise: a two-stage RMI. A root model routes the key to one of many
+//    leaf lines, each fitted to its keys with a recorded error window, and
+//    the final step is a lower_bound inside that window.
+// All methods return the first index with arr[i] >= x.
+class AdaptiveIndex {
+    static const int SAMPLES = 1024;
+    static const int SEQ_WINDOW = 32;
+    static const int MAX_PROBES = 3;           // average interpolation probes allowed
+    static const int KEYS_PER_LEAF = 256;
+    static const int LOG_PROBES = 16;          // interpolation probes before halving
+
+    struct Leaf {
+        double slope = 0, intercept = 0;
+        int errLo = 0, errHi = 0;              // window around the prediction
+        size_t start = 0;                      // first key routed to this leaf
+    };
+
+    const int* a;
+    size_t n;
+    string chosen;
+    double sampleError = 0, averageProbes = 0;
+    vector<int> rootKeys;
+    vector<size_t> rootPos;
+    vector<Leaf> leaves;
+
+    size_t interpolate(int x, size_t lo, size_t hi) const {
+        // Position of x on the line through a[lo] and a[hi].
+        if (a[hi] == a[lo]) return lo;
+        double f = ((double)x - a[lo]) / ((double)a[hi] - a[lo]);
+        f = min(1.0, max(0.0, f));
+        return lo + (size_t)(f * (hi - lo));
+    }
+
+    size_t interpolationSequential(int x) const {
+        size_t i = interpolate(x, 0, n - 1);
+        if (a[i] < x) {
+            while (i < n && a[i] < x) ++i;
+        } else {
+            while (i > 0 && a[i - 1] >= x) --i;
+        }
+        return i;
+    }
+
+    // Interpolation search that switches to halving after LOG_PROBES probes,
+    // so skewed inputs cost O(log n) instead of O(n).
+    size_t interpolationSearch(int x, int* probes = nullptr) const {
+        size_t lo = 0, hi = n - 1;
+        if (x <= a[0]) return 0;
+        if (x > a[hi]) return n;
+        // Invariant: a[lo] < x <= a[hi].
+        int count = 0;
+        while (hi - lo > 1) {
+            ++count;
+            size_t mid = count > LOG_PROBES ? lo + (hi - lo) / 2 : interpolate(x, lo, hi);
+            mid = min(hi - 1, max(lo + 1, mid));
+            if (a[mid] < x) lo = mid;
+            else hi = mid;
+        }
+        if (probes) *probes = count;
+        return hi;
+    }
+
+    // Root model: a piecewise-linear CDF through the sampled keys, which
+    // spreads keys evenly over the leaves even when the data is skewed.
+    // It is monotone, so every leaf owns a contiguous range of the array.
+    size_t rootLeaf(int x) const {
+        if (x <= rootKeys.front()) return 0;
+        if (x >= rootKeys.back()) return leaves.size() - 1;
+        size_t j = lowerBoundBranchless(rootKeys.data(), rootKeys.size(), x + 1) - 1;   // rootKeys[j] <= x < rootKeys[j + 1]
+        double f = ((double)x - rootKeys[j]) / ((double)rootKeys[j + 1] - rootKeys[j]);
+        double pos = rootPos[j] + f * ((double)rootPos[j + 1] - rootPos[j]);
+        return min(leaves.size() - 1, (size_t)(pos / KEYS_PER_LEAF));
+    }
+
+    void buildRmi() {
+        size_t count = max<size_t>(1, n / KEYS_PER_LEAF);
+        leaves.assign(count, Leaf());
+        size_t step = max<size_t>(1, n / SAMPLES);
+        for (size_t i = 0; i < n; i += step) {
+            rootKeys.push_back(a[i]);
+            rootPos.push_back(i);
+        }
+        rootKeys.push_back(a[n - 1]);
+        rootPos.push_back(n - 1);
+
+        // Empty leaves predict their start, which is exactly the lower bound
+        // of any key routed to them.
+        vector<size_t> end(count, 0);
+        for (size_t l = 0, i = 0; l < count; ++l) {
+            leaves[l].start = i;
+            while (i < n && rootLeaf(a[i]) == l) ++i;
+            end[l] = i;
+        }
+        for (size_t l = 0; l < count; ++l) {
+            Leaf& leaf = leaves[l];
+            size_t first = leaf.start, last = end[l];
+            leaf.intercept = first;
+            if (last - first >= 2 && a[last - 1] != a[first]) {
+                leaf.slope = (double)(last - 1 - first) / ((double)a[last - 1] - a[first]);
+                leaf.intercept = first - leaf.slope * a[first];
+            }
+            for (size_t i = first; i < last; ++i) {
+                long long err = (long long)i - predict(leaf, a[i]);
+                leaf.errLo = min<long long>(leaf.errLo, err);
+                leaf.errHi = max<long long>(leaf.errHi, err);
+            }
+        }
+    }
+
+    static long long predict(const Leaf& leaf, int x) { return (long long)(leaf.slope * x + leaf.intercept); }
+
+    size_t rmiSearch(int x) const {
+        size_t l = rootLeaf(x);
+        const Leaf& leaf = leaves[l];
+        size_t leafEnd = l + 1 < leaves.size() ? leaves[l + 1].start : n;
+        long long p = predict(leaf, x);
+        size_t lo = max<long long>(leaf.start, min<long long>(leafEnd, p + leaf.errLo));
+        size_t hi = max<long long>(lo, min<long long>(leafEnd, p + leaf.errHi + 1));
+        size_t r = lo + lowerBoundBranchless(a + lo, hi - lo, x);
+        // The window is exact for stored keys; a missing key between two
+        // stored ones can land just outside it, which these checks repair.
+        if (r == lo && lo > leaf.start && a[lo - 1] >= x) r = leaf.start + lowerBoundBranchless(a + leaf.start, lo - leaf.start, x);
+        else if (r == hi && hi < leafEnd && a[hi] < x) r = hi + lowerBoundBranchless(a + hi, leafEnd - hi, x);
+        return r;
+    }
+
+public:
+    AdaptiveIndex(const vector<int>& arr) : a(arr.data()), n(arr.size()) {
+        if (n < 2) {
+            chosen = "interpolation-sequential";
+            return;
+        }
+        size_t step = max<size_t>(1, n / SAMPLES);
+        double totalProbes = 0;
+        int sampled = 0;
+        for (size_t i = 0; i < n; i += step, ++sampled) {
+            sampleError = max(sampleError, fabs((double)interpolate(a[i], 0, n - 1) - (double)i));
+            int probes = 0;
+            interpolationSearch(a[i], &probes);
+            totalProbes += probes;
+        }
+        averageProbes = totalProbes / sampled;
+        if (sampleError <= SEQ_WINDOW) {
+            chosen = "interpolation-sequential";
+        } else if (averageProbes <= MAX_PROBES) {
+            chosen = "interpolation";
+        } else {
+            chosen = "rmi";
+            buildRmi();
+        }
+    }
+
+    const string& model() const { return chosen; }
+    double error() const { return sampleError; }
+    double probes() const { return averageProbes; }
+    size_t leafCount() const { return leaves.size(); }
+
+    size_t lowerBound(int x) const {
+        if (n == 0) return 0;
+        if (n == 1) return a[0] < x;
+        if (chosen == "rmi") return rmiSearch(x);
+        if (chosen == "interpolation") return interpolationSearch(x);
+        if (x > a[n - 1]) return n;
+        return interpolationSequential(x);
+    }
+};
+
+// Sorted keys for the adaptive benchmark: the repo's i * 2, uniform random,
+// or a lognormal spread that defeats plain interpolation.
+vector<int> makeKeys(size_t n, const string& dist) {
+    vector<int> keys(n);
+    mt19937_64 rng(7);
+    if (dist == "uniform") {
+        for (int& k : keys) k = (int)(rng() % 2000000000);
+    } else if (dist == "lognormal") {
+        lognormal_distribution<double> d(0, 2);
+        for (int& k : keys) k = (int)min(2e9, d(rng) * 1e6);
+    } else {
+        for (size_t i = 0; i < n; ++i) keys[i] = (int)(i * 2);
+        return keys;
+    }
+    sort(keys.begin(), keys.end());
+    return keys;
+}
+
+void adaptiveBenchmark(size_t n, size_t q, const string& dist) {
+    traceOn = false;
+    vector<int> arr = makeKeys(n, dist);
+    auto start = steady_clock::now();
+    AdaptiveIndex index(arr);
+    double buildMs = duration_cast<duration<double, milli>>(steady_clock::now() - start).count();
+    cout << R"({"action":"adaptive","distribution":")" << dist << R"(","model":")" << index.model()
+         << R"(","sampleError":)" << index.error() << R"(,"interpolationProbes":)" << index.probes() << R"(,"leaves":)" << index.leafCount()
+         << R"(,"buildMs":)" << buildMs << "}" << endl;
+
+    vector<int> queries(q);
+    mt19937_64 rng(42);
+    for (int& x : queries) x = rng() % 2 ? arr[rng() % n] : (int)(rng() % ((long long)arr[n - 1] + 2));
+
+    benchMethod("branchless", n, queries, [&] {
+        long long found = 0;
+        for (int x : queries) {
+            size_t i = lowerBoundBranchless(arr.data(), n, x);
+            found += i < n && arr[i] == x;
+        }
+        return found;
+    });
+    benchMethod(index.model(), n, queries, [&] {
+        long long found = 0;
+        for (int x : queries) {
+            size_t i = index.lowerBound(x);
+            found += i < n && arr[i] == x;
+        }
+        return found;
+    });
+    cout << R"({"action":"final"})" << endl;
+}
+
 int main(int argc, char* argv[]) {
     int n, target;
     vector<int> arr;
+    string mode = argc > 1 ? argv[1] : "";
+    StatsReport report(mode == "bench" || mode == "adaptive" ? "binary-search-" + mode : "binary-search");
+
+    if (argc > 1 && string(argv[1]) == "bench") {
+        // bench [n] [queries]; n up to 10^9 (keys are i * 2 and must fit in int)
+        size_t size = argc > 2 ? stoull(argv[2]) : 1ULL << 26;
+        size_t queries = argc > 3 ? stoull(argv[3]) : 1000000;
+        if (size < 1 || size > 1000000000ULL || queries < 1) {
+            cout << R"({"error":"Invalid array size"})" << endl;
+            return 1;
+        }
+        benchmark(size, queries);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "adaptive") {
+        // adaptive [n] [queries] [even|uniform|lognormal]
+        size_t size = argc > 2 ? stoull(argv[2]) : 1ULL << 24;
+        size_t queries = argc > 3 ? stoull(argv[3]) : 1000000;
+        if (size < 1 || size > 1000000000ULL || queries < 1) {
+            cout << R"({"error":"Invalid array size"})" << endl;
+            return 1;
+        }
+        adaptiveBenchmark(size, queries, argc > 4 ? argv[4] : "even");
+        return 0;
+    }
 
     if (argc > 2) {
         n = stoi(argv[1]);
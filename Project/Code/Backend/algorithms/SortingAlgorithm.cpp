@@ -3,15 +3,43 @@
 #include <string>
 #include <sstream>
 #include <algorithm>
+#include <memory_resource>
+#include <string_view>
+#include <cstdlib>
+#include <cerrno>
+#include <chrono>
+#include <queue>
+#include <random>
+#include "trace.h"
+#include "stats.h"
+#include "arena.h"
+#include "sort_engine.h"
+#include "select.h"
 
 using namespace std;
 
-void printStep(const vector<int>& arr, const string& message, int depth, int position, const string& action, int pivotIndex = -1, int swapA = -1, int swapB = -1) {
+template <class T>
+void printElement(const T& x) { cout << x; }
+
+void printElement(const string& s) {
+    cout << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') cout << '\\' << c;
+        else if ((unsigned char)c < 0x20) cout << "\\u00" << "0123456789abcdef"[c >> 4] << "0123456789abcdef"[c & 15];
+        else cout << c;
+    }
+    cout << '"';
+}
+
+// Prints the elements in [first, last) as the step's array.
+template <class T>
+void printStep(const T* first, const T* last, string_view message, int depth, int position, string_view action, int pivotIndex = -1, int swapA = -1, int swapB = -1) {
+    if (!traceKeep(action == "initial" || action == "final")) return;
     cout << "{";
     cout << "\"array\": [";
-    for (int i = 0; i < arr.size(); ++i) {
-        cout << arr[i];
-        if (i < arr.size() - 1) cout << ", ";
+    for (const T* it = first; it != last; ++it) {
+        printElement(*it);
+        if (it + 1 != last) cout << ", ";
     }
     cout << "], ";
     cout << "\"message\": \"" << message << "\", ";
@@ -23,82 +51,119 @@ void printStep(const vector<int>& arr, const string& message, int depth, int pos
     cout << "}" << endl;
 }
 
-void quickSort(vector<int>& arr, int low, int high, int depth, int position) {
-    if (low >= high) {
-        if (low == high) {
-            printStep(arr, "Single element, no need to sort", depth, position, "base");
-        }
-        return;
-    }
+template <class T>
+void printStep(const vector<T>& arr, string_view message, int depth, int position, string_view action, int pivotIndex = -1, int swapA = -1, int swapB = -1) {
+    printStep(arr.data(), arr.data() + arr.size(), message, depth, position, action, pivotIndex, swapA, swapB);
+}
 
-    int pivot = arr[high];
+// Lomuto partition of arr[low..high] around arr[high]; returns the pivot's
+// final index.
+template <class T>
+int partition(vector<T>& arr, int low, int high, int depth, int position) {
+    T pivot = arr[high];
     int i = low - 1;
 
-    printStep(arr, "Selecting pivot " + to_string(pivot) + " at index " + to_string(high), depth, position, "pivot", high);
+    printStep(arr, stepText("Selecting pivot ", pivot, " at index ", high), depth, position, "pivot", high);
 
     for (int j = low; j < high; ++j) {
+        statAdd(Stat::Comparisons);
         if (arr[j] <= pivot) {
             ++i;
             if (i != j) {
                 swap(arr[i], arr[j]);
-                printStep(arr, "Swapping " + to_string(arr[i]) + " and " + to_string(arr[j]), depth, position, "swap", high, i, j);
+                statAdd(Stat::Swaps);
+                printStep(arr, stepText("Swapping ", arr[i], " and ", arr[j]), depth, position, "swap", high, i, j);
             }
         }
     }
 
     swap(arr[i + 1], arr[high]);
+    statAdd(Stat::Swaps);
     printStep(arr, "Placing pivot at correct position", depth, position, "pivot-swap", i + 1, high);
+    return i + 1;
+}
 
-    int pivotIndex = i + 1;
+template <class T>
+void quickSort(vector<T>& arr, int low, int high, int depth, int position) {
+    if (low >= high) {
+        if (low == high) {
+            printStep(arr, "Single element, no need to sort", depth, position, "base");
+        }
+        return;
+    }
+
+    int pivotIndex = partition(arr, low, high, depth, position);
     quickSort(arr, low, pivotIndex - 1, depth + 1, position * 2);
     quickSort(arr, pivotIndex + 1, high, depth + 1, position * 2 + 1);
 }
 
-void merge(vector<int>& arr, int left, int mid, int right, int depth, int position) {
-    vector<int> leftArr(arr.begin() + left, arr.begin() + mid + 1);
-    vector<int> rightArr(arr.begin() + mid + 1, arr.begin() + right + 1);
+// Quickselect: partitions only the side holding index k until the pivot
+// lands there, leaving arr[k] where a full sort would put it.
+template <class T>
+void quickSelect(vector<T>& arr, int low, int high, int k, int depth, int position) {
+    while (low < high) {
+        int pivotIndex = partition(arr, low, high, depth, position);
+        if (pivotIndex == k) return;
+        if (k < pivotIndex) {
+            high = pivotIndex - 1;
+            position = position * 2;
+        } else {
+            low = pivotIndex + 1;
+            position = position * 2 + 1;
+        }
+        ++depth;
+    }
+}
+
+// scratch has arr.size() elements; both halves are copied to the same
+// indices in it and merged back.
+template <class T>
+void merge(vector<T>& arr, int left, int mid, int right, int depth, int position, T* scratch) {
+    copy(arr.begin() + left, arr.begin() + right + 1, scratch + left);
 
-    int i = 0, j = 0, k = left;
+    int i = left, j = mid + 1, k = left;
 
-    while (i < (int)leftArr.size() && j < (int)rightArr.size()) {
-        if (leftArr[i] <= rightArr[j]) arr[k++] = leftArr[i++];
-        else arr[k++] = rightArr[j++];
+    while (i <= mid && j <= right) {
+        statAdd(Stat::Comparisons);
+        if (scratch[i] <= scratch[j]) arr[k++] = scratch[i++];
+        else arr[k++] = scratch[j++];
     }
 
-    while (i < (int)leftArr.size()) arr[k++] = leftArr[i++];
-    while (j < (int)rightArr.size()) arr[k++] = rightArr[j++];
+    while (i <= mid) arr[k++] = scratch[i++];
+    while (j <= right) arr[k++] = scratch[j++];
 
-    vector<int> merged(arr.begin() + left, arr.begin() + right + 1);
-    printStep(merged, "Merged from " + to_string(left) + " to " + to_string(right), depth, position, "merge");
+    printStep(&arr[left], &arr[right] + 1, stepText("Merged from ", left, " to ", right), depth, position, "merge");
 }
 
-void mergeSort(vector<int>& arr, int left, int right, int depth, int position) {
+template <class T>
+void mergeSort(vector<T>& arr, int left, int right, int depth, int position, T* scratch) {
     if (left == right) {
-        vector<int> singleElement = { arr[left] };
-        printStep(singleElement, "An array of length 1 cannot be split, ready for merge", depth, position, "base");
+        printStep(&arr[left], &arr[left] + 1, "An array of length 1 cannot be split, ready for merge", depth, position, "base");
         return;
     }
 
     int mid = left + (right - left) / 2;
 
-    vector<int> current(arr.begin() + left, arr.begin() + right + 1);
-    printStep(current, "Splitting", depth, position, "split");
+    printStep(&arr[left], &arr[right] + 1, "Splitting", depth, position, "split");
 
-    mergeSort(arr, left, mid, depth + 1, position * 2);
-    mergeSort(arr, mid + 1, right, depth + 1, position * 2 + 1);
-    merge(arr, left, mid, right, depth, position);
+    mergeSort(arr, left, mid, depth + 1, position * 2, scratch);
+    mergeSort(arr, mid + 1, right, depth + 1, position * 2 + 1, scratch);
+    merge(arr, left, mid, right, depth, position, scratch);
 }
 
-void bubbleSort(vector<int>& arr) {
+template <class T>
+void bubbleSort(vector<T>& arr) {
     int n = arr.size();
     for (int i = 0; i < n - 1; ++i) {
         for (int j = 0; j < n - i - 1; ++j) {
-            printStep(arr, "Comparing " + to_string(arr[j]) + " and " + to_string(arr[j + 1]),
+            printStep(arr, stepText("Comparing ", arr[j], " and ", arr[j + 1]),
                       1, i * n + j, "compare", -1, j, j + 1);
 
+            statAdd(Stat::Comparisons);
             if (arr[j] > arr[j + 1]) {
                 swap(arr[j], arr[j + 1]);
-                printStep(arr, "Swapping " + to_string(arr[j]) + " and " + to_string(arr[j + 1]),
+                statAdd(Stat::Swaps);
+                printStep(arr, stepText("Swapping ", arr[j], " and ", arr[j + 1]),
                           1, i * n + j, "swap", -1, j, j + 1);
             } else {
                 printStep(arr, "No swap needed", 1, i * n + j, "no-swap", -1, j, j + 1);
@@ -108,60 +173,65 @@ void bubbleSort(vector<int>& arr) {
 }
 
 
-void selectionSort(vector<int>& arr) {
+template <class T>
+void selectionSort(vector<T>& arr) {
     int n = arr.size();
     for (int i = 0; i < n - 1; ++i) {
         int minIdx = i;
         for (int j = i + 1; j < n; ++j) {
-            printStep(arr, "Comparing " + to_string(arr[j]) + " with current min " + to_string(arr[minIdx]), 1, 0, "compare", -1, j, minIdx);
+            printStep(arr, stepText("Comparing ", arr[j], " with current min ", arr[minIdx]), 1, 0, "compare", -1, j, minIdx);
+            statAdd(Stat::Comparisons);
             if (arr[j] < arr[minIdx]) {
                 minIdx = j;
             }
         }
         if (minIdx != i) {
             swap(arr[i], arr[minIdx]);
-            printStep(arr, "Swapping " + to_string(arr[i]) + " and " + to_string(arr[minIdx]), 1, 0, "swap", -1, i, minIdx);
+            statAdd(Stat::Swaps);
+            printStep(arr, stepText("Swapping ", arr[i], " and ", arr[minIdx]), 1, 0, "swap", -1, i, minIdx);
         }
     }
 }
-void insertionSort(vector<int>& arr) {
+template <class T>
+void insertionSort(vector<T>& arr) {
     int n = arr.size();
     for (int i = 1; i < n; ++i) {
-        int key = arr[i];
+        T key = arr[i];
         int j = i - 1;
 
-        while (j >= 0 && arr[j] > key) {
+        while (j >= 0 && (statAdd(Stat::Comparisons), arr[j] > key)) {
             arr[j + 1] = arr[j];
-            printStep(arr, "Shifting " + to_string(arr[j]) + " to right", 1, i, "shift", -1, j, j + 1);
+            statAdd(Stat::Swaps);           // one shift
+            printStep(arr, stepText("Shifting ", arr[j], " to right"), 1, i, "shift", -1, j, j + 1);
             j--;
         }
         arr[j + 1] = key;
-        printStep(arr, "Inserting " + to_string(key) + " at position " + to_string(j + 1), 1, i, "insert", -1);
+        printStep(arr, stepText("Inserting ", key, " at position ", j + 1), 1, i, "insert", -1);
     }
 }
 
 void countingSort(vector<int>& arr, int depth, int position) {
     int maxVal = *max_element(arr.begin(), arr.end());
-    vector<int> count(maxVal + 1, 0);
-    vector<int> output(arr.size());
+    pmr::vector<int> count(maxVal + 1, 0, runMemory());
+    pmr::vector<int> output(arr.size(), runMemory());
 
     for (int i = 0; i < arr.size(); i++) {
         count[arr[i]]++;
-        printStep(arr, "Counting element " + to_string(arr[i]), depth, position, "count", -1, arr[i], -1);
+        printStep(arr, stepText("Counting element ", arr[i]), depth, position, "count", -1, arr[i], -1);
     }
 
     for (int i = 1; i <= maxVal; i++) {
         count[i] += count[i - 1];
-        printStep(arr, "Building prefix sum at index " + to_string(i), depth, position, "prefix", -1, i, -1);
+        printStep(arr, stepText("Building prefix sum at index ", i), depth, position, "prefix", -1, i, -1);
     }
 
     for (int i = arr.size() - 1; i >= 0; i--) {
         output[count[arr[i]] - 1] = arr[i];
         count[arr[i]]--;
-        printStep(output, "Placing " + to_string(arr[i]) + " at correct position", depth, position, "place", -1, count[arr[i]], i);
+        printStep(output.data(), output.data() + output.size(), stepText("Placing ", arr[i], " at correct position"), depth, position, "place", -1, count[arr[i]], i);
     }
 
-    arr = output;
+    copy(output.begin(), output.end(), arr.begin());
 }
 
 int getDigit(int num, int exp) {
@@ -171,61 +241,68 @@ int getDigit(int num, int exp) {
 void radixSort(vector<int>& arr, int depth, int position) {
     int maxVal = *max_element(arr.begin(), arr.end());
     int exp = 1;
+    pmr::vector<int> output(arr.size(), runMemory());
+    pmr::vector<int> count(10, runMemory());
 
     while (maxVal / exp > 0) {
-        vector<int> output(arr.size());
-        vector<int> count(10, 0);
+        fill(output.begin(), output.end(), 0);
+        fill(count.begin(), count.end(), 0);
 
         for (int i = 0; i < arr.size(); i++) {
             int digit = getDigit(arr[i], exp);
             count[digit]++;
-            printStep(arr, to_string(arr[i]) + " has digit " + to_string(digit) + " at exp " + to_string(exp), depth, position, "digit", -1, digit, i);
+            printStep(arr, stepText(arr[i], " has digit ", digit, " at exp ", exp), depth, position, "digit", -1, digit, i);
         }
 
         for (int i = 1; i < 10; i++) {
             count[i] += count[i - 1];
-            printStep(arr, "Building prefix sum for digit " + to_string(i), depth, position, "prefix", -1, i, -1);
+            printStep(arr, stepText("Building prefix sum for digit ", i), depth, position, "prefix", -1, i, -1);
         }
 
         for (int i = arr.size() - 1; i >= 0; i--) {
             int digit = getDigit(arr[i], exp);
             output[count[digit] - 1] = arr[i];
             count[digit]--;
-            printStep(output, "Placing " + to_string(arr[i]) + " based on digit " + to_string(digit), depth, position, "place", -1, count[digit], i);
+            printStep(output.data(), output.data() + output.size(), stepText("Placing ", arr[i], " based on digit ", digit), depth, position, "place", -1, count[digit], i);
         }
 
-        arr = output;
+        copy(output.begin(), output.end(), arr.begin());
         exp *= 10;
     }
 }
 
+bool isInteger(const char* text) {
+    char* end;
+    errno = 0;
+    long value = strtol(text, &end, 10);
+    return *text && !*end && errno == 0 && value >= INT32_MIN && value <= INT32_MAX;
+}
 
-
-
-vector<int> parseInput(int argc, char* argv[], int startIndex) {
-    vector<int> arr;
+template <class T>
+vector<T> parseInput(int argc, char* argv[], int startIndex) {
+    vector<T> arr;
     for (int i = startIndex; i < argc; ++i) {
-        arr.push_back(stoi(argv[i]));
+        if constexpr (is_same_v<T, string>) arr.push_back(argv[i]);
+        else if constexpr (is_integral_v<T>) arr.push_back((T)stoll(argv[i]));
+        else arr.push_back((T)stod(argv[i]));
     }
     return arr;
 }
 
-int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        cerr << "Algorithm name required.\n";
+// The step-by-step sorts, for int or double arrays. k is the rank for
+// quick-select and the prefix length for partial-sort.
+template <class T>
+int runTracer(const string& algorithm, vector<T>& arr, int k) {
+    if (k > (int)arr.size()) {
+        cerr << "Usage: " << algorithm << " <k> [values...], 1 <= k <= number of values\n";
         return 1;
     }
-
-    string algorithm = argv[1];
-    vector<int> arr;
-
-    if (argc > 2) arr = parseInput(argc, argv, 2);
-    else arr = { 7, 8, 9, 4, 80, 60, 78, 49 }; // default
-
     printStep(arr, "Initial array", 0, 0, "initial");
 
+    ScopedTimer timer("sort");
     if (algorithm == "merge-sort") {
-        mergeSort(arr, 0, arr.size() - 1, 1, 0);
+        pmr::vector<T> scratch(arr.size(), runMemory());
+        mergeSort(arr, 0, arr.size() - 1, 1, 0, scratch.data());
     } else if (algorithm == "quick-sort") {
         quickSort(arr, 0, arr.size() - 1, 1, 0);
     } else if (algorithm == "bubble-sort") {
@@ -234,14 +311,303 @@ int main(int argc, char* argv[]) {
         selectionSort(arr);
     } else if (algorithm == "insertion-sort") {
         insertionSort(arr);
-    }  else if (algorithm == "counting-sort") {
-        countingSort(arr, 1, 0);
-    } else if (algorithm == "radix-sort") {
-        radixSort(arr, 1, 0);
-    } else {
+    } else if (algorithm == "quick-select") {
+        quickSelect(arr, 0, arr.size() - 1, k - 1, 1, 0);
+        printStep(arr, stepText("Element ", k, " in sorted order is ", arr[k - 1]), 0, 0, "final", k - 1);
+        return 0;
+    } else if (algorithm == "partial-sort") {
+        quickSelect(arr, 0, arr.size() - 1, k - 1, 1, 0);
+        quickSort(arr, 0, k - 2, 1, 0);
+        printStep(arr, stepText("The ", k, " smallest elements are sorted"), 0, 0, "final", k - 1);
+        return 0;
+    } else if (algorithm == "counting-sort" || algorithm == "radix-sort") {
+        if constexpr (is_integral_v<T>) {
+            if (algorithm == "counting-sort") countingSort(arr, 1, 0);
+            else radixSort(arr, 1, 0);
+        } else {
+            cerr << algorithm << " needs integer input.\n";
+            return 1;
+        }
+    }
 
     printStep(arr, "Final sorted array", 0, 0, "final");
+    return 0;
+}
 
+// engine <int64|double|string> [values...]: sorts with sortBy and reports the
+// method it picked for the key type and size.
+template <class T>
+int runEngine(int argc, char* argv[]) {
+    vector<T> arr = parseInput<T>(argc, argv, 3);
+    printStep(arr, "Initial array", 0, 0, "initial");
+    SortMethod method = sortMethodFor<typename vector<T>::iterator>(arr.size());
+    {
+        ScopedTimer timer("sort");
+        sortBy(arr.begin(), arr.end());
+    }
+    printStep(arr, stepText("Sorted ", arr.size(), " elements by ", sortMethodName(method)), 0, 0, "final");
     return 0;
 }
+
+// top-k <k> [values... | -]: the k largest values, kept by a TopK while they
+// stream past; "-" reads whitespace-separated numbers from stdin until EOF.
+int runTopK(int argc, char* argv[]) {
+    long long k = argc > 2 ? stoll(argv[2]) : 0;
+    if (k < 1) {
+        cerr << "Usage: top-k <k> [values... | -]\n";
+        return 1;
+    }
+    TopK<double, Identity, greater<>> top(k);
+    long long seen = 0;
+    {
+        ScopedTimer timer("select");
+        if (argc == 4 && string(argv[3]) == "-") {
+            double value;
+            while (cin >> value) {
+                top.push(value);
+                ++seen;
+            }
+        } else {
+            for (int i = 3; i < argc; ++i) {
+                top.push(stod(argv[i]));
+                ++seen;
+            }
+        }
+    }
+    vector<double> best = top.take();
+    printStep(best, stepText("Top ", best.size(), " of ", seen, " values"), 0, 0, "final");
+    return 0;
+}
+
+template <class F>
+double timeMs(F f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// select-bench <n> <k> [threads]: times each selection on n random doubles,
+// sequential and parallel, against the standard library, one line per
+// operation.
+int runSelectBench(int argc, char* argv[]) {
+    long long n = argc > 2 ? stoll(argv[2]) : 0, k = argc > 3 ? stoll(argv[3]) : 0;
+    int threads = argc > 4 ? stoi(argv[4]) : defaultThreads();
+    if (n < 1 || k < 1 || k > n || threads < 1) {
+        cerr << "Usage: select-bench <n> <k> [threads], 1 <= k <= n\n";
+        return 1;
+    }
+    mt19937_64 random(42);
+    uniform_real_distribution<double> uniform(-1e9, 1e9);
+    vector<double> input(n);
+    for (double& x : input) x = uniform(random);
+
+    auto report = [&](const char* op, double stdMs, double sequentialMs, double parallelMs, bool verified) {
+        cout << R"({"type":"select","op":")" << op << R"(","n":)" << n << R"(,"k":)" << k
+             << R"(,"threads":)" << threads << R"(,"stdMs":)" << stdMs << R"(,"sequentialMs":)" << sequentialMs
+             << R"(,"parallelMs":)" << parallelMs << R"(,"verified":)" << (verified ? "true" : "false") << "}" << endl;
+    };
+
+    vector<double> expected = input, arr = input;
+    double stdMs = timeMs([&] { nth_element(expected.begin(), expected.begin() + (k - 1), expected.end()); });
+    double sequentialMs = timeMs([&] { nthElementBy(arr.begin(), arr.begin() + (k - 1), arr.end()); });
+    bool verified = arr[k - 1] == expected[k - 1];
+    arr = input;
+    double parallelMs = timeMs([&] { parallelNthElementBy(arr.begin(), arr.begin() + (k - 1), arr.end(), Identity{}, less<>(), threads); });
+    report("nth-element", stdMs, sequentialMs, parallelMs, verified && arr[k - 1] == expected[k - 1]);
+
+    expected = input;
+    arr = input;
+    stdMs = timeMs([&] { partial_sort(expected.begin(), expected.begin() + k, expected.end()); });
+    sequentialMs = timeMs([&] { partialSortBy(arr.begin(), arr.begin() + k, arr.end()); });
+    verified = equal(arr.begin(), arr.begin() + k, expected.begin());
+    arr = input;
+    parallelMs = timeMs([&] { parallelPartialSortBy(arr.begin(), arr.begin() + k, arr.end(), Identity{}, less<>(), threads); });
+    report("partial-sort", stdMs, sequentialMs, parallelMs, verified && equal(arr.begin(), arr.begin() + k, expected.begin()));
+
+    // The standard library has no streaming top-k; a bounded heap of k
+    // elements is the usual stand-in.
+    vector<double> heap;
+    stdMs = timeMs([&] {
+        priority_queue<double, vector<double>, greater<>> best;
+        for (double x : input) {
+            if ((long long)best.size() < k) best.push(x);
+            else if (x > best.top()) {
+                best.pop();
+                best.push(x);
+            }
+        }
+        for (; !best.empty(); best.pop()) heap.push_back(best.top());
+        reverse(heap.begin(), heap.end());
+    });
+    vector<double> top;
+    sequentialMs = timeMs([&] {
+        TopK<double, Identity, greater<>> stream(k);
+        for (double x : input) stream.push(x);
+        top = stream.take();
+    });
+    verified = top == heap;
+    parallelMs = timeMs([&] { top = parallelTopK(input.begin(), input.end(), k, Identity{}, greater<>(), threads); });
+    report("top-k", stdMs, sequentialMs, parallelMs, verified && top == heap);
+    return 0;
+}
+
+// ---- auto-sort ----
+
+// What auto-sort knows about its input before choosing. min and max come
+// from a full scan; the rest from samples of PROFILE_SAMPLE elements or pairs.
+struct InputProfile {
+    size_t n = 0;
+    double minValue = 0, maxValue = 0;
+    bool integral = false;
+    double runs = 1;            // estimated ascending or descending runs
+    double inversions = 0;      // fraction of sampled pairs out of order: 0 sorted, 0.5 random, 1 reversed
+    double duplicates = 0;      // fraction of sampled elements equal to another sampled element
+};
+
+const int PROFILE_SAMPLE = 1024;
+const size_t AUTO_INSERTION_MAX = 32;
+const double AUTO_RUN_MERGE_FRACTION = 1.0 / 64;   // run-merge when runs <= n / 64
+const double AUTO_COUNTING_RANGE = 2;              // counting sort when max - min < 2n
+
+template <class T>
+InputProfile profileInput(const vector<T>& arr) {
+    InputProfile profile;
+    size_t n = profile.n = arr.size();
+    profile.integral = is_integral_v<T>;
+    if (n < 2) return profile;
+    auto [low, high] = minmax_element(arr.begin(), arr.end());
+    profile.minValue = *low;
+    profile.maxValue = *high;
+
+    // Runs: descents and ascents among evenly spaced adjacent pairs. A run
+    // ends where the direction changes, so the rarer of the two counts them.
+    size_t pairs = min<size_t>(n - 1, PROFILE_SAMPLE), descents = 0, ascents = 0;
+    for (size_t s = 0; s < pairs; ++s) {
+        size_t i = s * (n - 1) / pairs;
+        if (arr[i + 1] < arr[i]) ++descents;
+        else if (arr[i] < arr[i + 1]) ++ascents;
+    }
+    profile.runs = 1 + (double)min(descents, ascents) / pairs * (n - 1);
+
+    mt19937_64 random(n);
+    size_t inverted = 0;
+    for (int s = 0; s < PROFILE_SAMPLE; ++s) {
+        size_t i = random() % n, j = random() % n;
+        if (i > j) swap(i, j);
+        if (arr[j] < arr[i]) ++inverted;
+    }
+    profile.inversions = (double)inverted / PROFILE_SAMPLE;
+
+    size_t samples = min<size_t>(n, PROFILE_SAMPLE);
+    vector<T> sample(samples);
+    for (size_t s = 0; s < samples; ++s) sample[s] = arr[s * n / samples];
+    sortBy(sample.begin(), sample.end());
+    size_t distinct = unique(sample.begin(), sample.end()) - sample.begin();
+    profile.duplicates = 1 - (double)distinct / samples;
+    return profile;
+}
+
+string chooseSort(const InputProfile& profile) {
+    double n = profile.n;
+    if (profile.n <= AUTO_INSERTION_MAX) return "insertion";
+    if (profile.runs <= max(2.0, n * AUTO_RUN_MERGE_FRACTION)) return "run-merge";
+    if (profile.integral && profile.maxValue - profile.minValue < AUTO_COUNTING_RANGE * n) return "counting";
+    return "parallel";
+}
+
+// Counting sort over [low, high], untraced.
+template <class T>
+void countingSortRange(vector<T>& arr, long long low, long long high) {
+    pmr::vector<size_t> count(high - low + 1, 0, runMemory());
+    for (T x : arr) ++count[(long long)x - low];
+    size_t at = 0;
+    for (long long v = 0; v <= high - low; ++v)
+        for (size_t c = count[v]; c > 0; --c) arr[at++] = (T)(v + low);
+}
+
+// auto-sort [values...]: profiles the input, picks the sort from it and
+// reports the profile, the choice and the time as a {"type":"decision"}
+// record, so the thresholds above can be tuned from logged runs.
+template <class T>
+int runAutoSort(vector<T>& arr) {
+    printStep(arr, "Initial array", 0, 0, "initial");
+    int threads = defaultThreads();
+    InputProfile profile;
+    string method;
+    double profileMs = timeMs([&] {
+        profile = profileInput(arr);
+        method = chooseSort(profile);
+    });
+    double sortMs = timeMs([&] {
+        if (method == "insertion") {
+            auto comp = less<>();
+            insertionSort(arr.begin(), arr.end(), comp);
+        } else if (method == "run-merge") {
+            runMergeSortBy(arr.begin(), arr.end());
+        } else if (method == "counting") {
+            if constexpr (is_integral_v<T>) countingSortRange(arr, profile.minValue, profile.maxValue);
+        } else {
+            parallelSortBy(arr.begin(), arr.end(), Identity{}, less<>(), threads);
+        }
+    });
+    const char* leaf = method == "parallel" ? sortMethodName(sortMethodFor<typename vector<T>::iterator>(arr.size() / threads)) : "";
+    cout << R"({"type":"decision","algorithm":"auto-sort","n":)" << profile.n << R"(,"integral":)"
+         << (profile.integral ? "true" : "false") << R"(,"min":)" << profile.minValue << R"(,"max":)" << profile.maxValue
+         << R"(,"runs":)" << profile.runs << R"(,"inversions":)" << profile.inversions << R"(,"duplicates":)"
+         << profile.duplicates << R"(,"method":")" << method << R"(","leaf":")" << leaf << R"(","threads":)"
+         << (method == "parallel" ? threads : 1) << R"(,"profileMs":)" << profileMs << R"(,"sortMs":)" << sortMs << "}"
+         << endl;
+    printStep(arr, stepText("Sorted by ", method), 0, 0, "final");
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "Algorithm name required.\n";
+        return 1;
+    }
+
+    string algorithm = argv[1];
+    StatsReport report(algorithm);
+    RunArena arena;
+
+    if (algorithm == "engine") {
+        string keyType = argc > 2 ? argv[2] : "";
+        if (keyType == "int64") return runEngine<long long>(argc, argv);
+        if (keyType == "double") return runEngine<double>(argc, argv);
+        if (keyType == "string") return runEngine<string>(argc, argv);
+        cerr << "Usage: engine <int64|double|string> [values...]\n";
+        return 1;
+    }
+
+    if (algorithm == "top-k") return runTopK(argc, argv);
+    if (algorithm == "auto-sort") {
+        if (argc > 2 && !all_of(argv + 2, argv + argc, isInteger)) {
+            vector<double> arr = parseInput<double>(argc, argv, 2);
+            return runAutoSort(arr);
+        }
+        vector<int> arr = parseInput<int>(argc, argv, 2);
+        return runAutoSort(arr);
+    }
+    if (algorithm == "select-bench") return runSelectBench(argc, argv);
+
+    int first = 2, k = 0;
+    if (algorithm == "quick-select" || algorithm == "partial-sort") {
+        k = argc > 2 ? stoi(argv[2]) : 0;
+        first = 3;
+        if (k < 1) {
+            cerr << "Usage: " << algorithm << " <k> [values...], 1 <= k <= number of values\n";
+            return 1;
+        }
+    }
+
+    if (argc > first && !all_of(argv + first, argv + argc, isInteger)) {
+        vector<double> arr = parseInput<double>(argc, argv, first);
+        return runTracer(algorithm, arr, k);
+    }
+
+    vector<int> arr;
+    if (argc > first) arr = parseInput<int>(argc, argv, first);
+    else arr = { 7, 8, 9, 4, 80, 60, 78, 49 }; // default
+    return runTracer(algorithm, arr, k);
 }
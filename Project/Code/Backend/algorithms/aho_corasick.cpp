@@ -0,0 +1,279 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <array>
+#include <queue>
+#include <chrono>
+#include <algorithm>
+#include "trace.h"
+#include "stats.h"
+
+using namespace std;
+using namespace std::chrono;
+
+const size_t TRACE_LIMIT = 256;              // longer texts are searched without per-character steps
+const long long DFA_CELL_LIMIT = 1LL << 24;  // full transition table only below this many cells
+
+bool traceOn = true;
+
+void logStep(const string& text,
+             const string& pattern,
+             int l,
+             int r,
+             const string& message) {
+    if (!traceOn || !traceKeep(traceImportant(message))) return;
+    cout << "{";
+    cout << "\"type\":\"Aho-Corasick\", ";
+    if (l >= 0)     cout << "\"l\":"       << l       << ", ";
+    if (r >= 0)     cout << "\"r\":"       << r       << ", ";
+    cout << "\"text\":\""    << jsonEscape(text)    << "\", ";
+    cout << "\"pattern\":\"" << jsonEscape(pattern) << "\", ";
+    cout << "\"message\":\"" << jsonEscape(message) << "\"";
+    cout << "}" << endl;
+}
+
+struct Match {
+    long long index;
+    int pattern;
+};
+
+// Aho-Corasick automaton over a compressed alphabet: bytes that occur in some
+// pattern get symbols 1..sigma-1, every other byte maps to 0 and always falls
+// back to the root. The failure link is the multi-pattern form of KMP's LPS:
+// fail[child] is the longest proper suffix of the child's string that is also
+// a trie prefix, found by following fail[parent] the way computeLPS follows
+// lps[len - 1].
+class AhoCorasick {
+    vector<string> patterns;
+    array<int, 256> symbol{};
+    int sigma = 1;
+
+    // Trie, children sorted by symbol; node ids follow insertion order.
+    vector<vector<pair<int, int>>> children;
+    vector<int> fail, depth, terminal, dictLink, samePattern;
+
+    // Full DFA: dfa[state * sigma + symbol] when it fits...
+    bool dense = false;
+    vector<int> dfa;
+    // ...otherwise a double array: child of s on c is base[s] + c when check[] agrees.
+    vector<int> base, check, slotOf, nodeOf;
+
+    int child(int node, int c) const {
+        for (auto& [sym, next] : children[node])
+            if (sym == c) return next;
+        return -1;
+    }
+
+    int dartGoto(int slot, int c) const {
+        int t = base[slot] + c;
+        return t < (int)check.size() && check[t] == slot ? t : -1;
+    }
+
+    void buildDoubleArray() {
+        int n = children.size();
+        slotOf.assign(n, -1);
+        base.assign(1, 0);
+        check.assign(1, -2);               // slot 0 is the root and is never a child slot
+        slotOf[0] = 0;
+        int searchFrom = 1;
+        for (int node = 0; node < n; ++node) {
+            int slot = slotOf[node];
+            auto& kids = children[node];
+            if (kids.empty()) continue;
+            while (searchFrom < (int)check.size() && check[searchFrom] != -1) ++searchFrom;
+            for (int b = max(1, searchFrom - kids.front().first);; ++b) {
+                bool fits = true;
+                for (auto& [c, next] : kids) {
+                    int t = b + c;
+                    if (t < (int)check.size() && check[t] != -1) {
+                        fits = false;
+                        break;
+                    }
+                }
+                if (!fits) continue;
+                if ((int)base.size() <= slot) base.resize(slot + 1, 0);
+                base[slot] = b;
+                for (auto& [c, next] : kids) {
+                    int t = b + c;
+                    if ((int)check.size() <= t) {
+                        check.resize(t + 1, -1);
+                        base.resize(t + 1, 0);
+                    }
+                    check[t] = slot;
+                    slotOf[next] = t;
+                }
+                break;
+            }
+        }
+        base.resize(check.size(), 0);
+        nodeOf.assign(check.size(), -1);
+        for (int node = 0; node < n; ++node) nodeOf[slotOf[node]] = node;
+    }
+
+public:
+    explicit AhoCorasick(const vector<string>& pats) : patterns(pats) {
+        for (auto& p : patterns)
+            for (unsigned char ch : p)
+                if (!symbol[ch]) symbol[ch] = sigma++;
+
+        children.assign(1, {});
+        depth.assign(1, 0);
+        terminal.assign(1, -1);
+        samePattern.assign(patterns.size(), -1);
+        for (int id = 0; id < (int)patterns.size(); ++id) {
+            int node = 0;
+            for (unsigned char ch : patterns[id]) {
+                int c = symbol[ch];
+                int next = child(node, c);
+                if (next < 0) {
+                    next = children.size();
+                    children.push_back({});
+                    depth.push_back(depth[node] + 1);
+                    terminal.push_back(-1);
+                    children[node].push_back({c, next});
+                }
+                node = next;
+            }
+            samePattern[id] = terminal[node];
+            terminal[node] = id;
+            logStep(patterns[id], patterns[id], id, node, "Inserted pattern into trie, ends at node " + to_string(node));
+        }
+        for (auto& kids : children) sort(kids.begin(), kids.end());
+
+        int n = children.size();
+        fail.assign(n, 0);
+        dictLink.assign(n, -1);
+        vector<int> order;
+        order.reserve(n);
+        queue<int> bfs;
+        bfs.push(0);
+        while (!bfs.empty()) {
+            int node = bfs.front();
+            bfs.pop();
+            order.push_back(node);
+            for (auto& [c, next] : children[node]) {
+                if (node != 0) {
+                    int f = fail[node];
+                    while (f != 0 && child(f, c) < 0) f = fail[f];
+                    int target = child(f, c);
+                    fail[next] = target >= 0 ? target : 0;
+                }
+                int f = fail[next];
+                dictLink[next] = terminal[f] >= 0 ? f : dictLink[f];
+                bfs.push(next);
+            }
+        }
+
+        dense = (long long)n * sigma <= DFA_CELL_LIMIT && sigma <= 64;
+        if (dense) {
+            dfa.assign((size_t)n * sigma, 0);
+            for (int node : order) {
+                for (int c = 1; c < sigma; ++c) {
+                    int next = child(node, c);
+                    dfa[(size_t)node * sigma + c] = next >= 0 ? next : (node == 0 ? 0 : dfa[(size_t)fail[node] * sigma + c]);
+                }
+            }
+        } else {
+            buildDoubleArray();
+        }
+    }
+
+    const char* layout() const { return dense ? "dfa" : "double-array"; }
+    size_t states() const { return children.size(); }
+    int alphabet() const { return sigma; }
+
+    void report(int node, long long end, vector<Match>& out, const string& text) const {
+        for (int v = terminal[node] >= 0 ? node : dictLink[node]; v >= 0; v = dictLink[v]) {
+            for (int id = terminal[v]; id >= 0; id = samePattern[id]) {
+                long long start = end - (long long)patterns[id].size() + 1;
+                out.push_back({start, id});
+                logStep(text, patterns[id], (int)start, (int)patterns[id].size(),
+                        "Pattern " + patterns[id] + " found at index " + to_string(start));
+            }
+        }
+    }
+
+    // One pass over the text, every occurrence of every pattern.
+    vector<Match> search(const string& text) const {
+        vector<Match> matches;
+        int node = 0;
+        if (dense) {
+            for (size_t i = 0; i < text.size(); ++i) {
+                node = dfa[(size_t)node * sigma + symbol[(unsigned char)text[i]]];
+                logStep(text, "", (int)i, depth[node], "Read character, automaton at depth " + to_string(depth[node]));
+                if (terminal[node] >= 0 || dictLink[node] >= 0) report(node, i, matches, text);
+            }
+        } else {
+            int slot = 0;
+            for (size_t i = 0; i < text.size(); ++i) {
+                int c = symbol[(unsigned char)text[i]];
+                int t;
+                while ((t = c ? dartGoto(slot, c) : -1) < 0 && slot != 0) {
+                    slot = slotOf[fail[nodeOf[slot]]];
+                    logStep(text, "", (int)i, depth[nodeOf[slot]], "Mismatch, following failure link");
+                }
+                slot = t >= 0 ? t : 0;
+                node = nodeOf[slot];
+                logStep(text, "", (int)i, depth[node], "Read character, automaton at depth " + to_string(depth[node]));
+                if (terminal[node] >= 0 || dictLink[node] >= 0) report(node, i, matches, text);
+            }
+        }
+        return matches;
+    }
+};
+
+string readFile(const string& path) {
+    ifstream in(path, ios::binary);
+    stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+int main(int argc, char* argv[]) {
+    StatsReport report("aho-corasick");
+    string text = "ushers";
+    vector<string> patterns = {"he", "she", "his", "hers"};
+
+    if (argc > 3 && string(argv[1]) == "file") {
+        // file <text file> <pattern file, one per line>
+        text = readFile(argv[2]);
+        patterns.clear();
+        ifstream in(argv[3]);
+        for (string line; getline(in, line); )
+            if (!line.empty()) patterns.push_back(line);
+    } else {
+        if (argc > 1) text = argv[1];
+        if (argc > 2) patterns.assign(argv + 2, argv + argc);
+    }
+    patterns.erase(remove(patterns.begin(), patterns.end(), string()), patterns.end());
+    traceOn = text.size() <= TRACE_LIMIT && patterns.size() <= 32;
+
+    string joined;
+    for (size_t i = 0; i < patterns.size(); ++i) joined += (i ? "," : "") + patterns[i];
+    logStep(text, joined, -1, -1, "Building Aho-Corasick automaton");
+
+    auto start = steady_clock::now();
+    AhoCorasick automaton(patterns);
+    auto built = steady_clock::now();
+    vector<Match> matches = automaton.search(text);
+    auto done = steady_clock::now();
+
+    logStep(text, joined, -1, -1, "Search complete, " + to_string(matches.size()) + " matches");
+    if (!traceOn) {
+        for (auto& m : matches)
+            cout << "{\"type\":\"Aho-Corasick\", \"match\":" << m.index << ", \"pattern\":" << m.pattern << "}" << endl;
+    }
+    double seconds = duration_cast<duration<double>>(done - built).count();
+    cout << "{\"type\":\"Aho-Corasick\", \"action\":\"final\", "
+         << "\"patterns\":" << patterns.size() << ", "
+         << "\"states\":" << automaton.states() << ", "
+         << "\"alphabet\":" << automaton.alphabet() << ", "
+         << "\"layout\":\"" << automaton.layout() << "\", "
+         << "\"matches\":" << matches.size() << ", "
+         << "\"buildMs\":" << duration_cast<milliseconds>(built - start).count() << ", "
+         << "\"searchMBps\":" << (seconds > 0 ? text.size() / seconds / 1e6 : 0) << ", "
+         << "\"cacheable\":false}" << endl;
+    return 0;
+}
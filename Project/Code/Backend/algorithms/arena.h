@@ -0,0 +1,83 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Per-run memory. A binary declares `RunArena arena;` at the top of main;
+// buffers that live for the whole run (merge scratch, counting arrays, the
+// trace message buffer) are then carved out of one monotonic resource,
+// starting in a fixed block on main's stack, and released in one shot when
+// main returns.
+//
+// Monotonic memory is never reused before the end of the run, so allocate
+// sized-once buffers from runMemory(), not per-step temporaries. Per-step
+// text goes through stepText(), which reuses a single buffer.
+//
+// Like the stats counters, use it only from the thread running main.
+
+const size_t RUN_ARENA_BLOCK = 64 * 1024;
+
+class RunArena {
+    alignas(std::max_align_t) std::byte block[RUN_ARENA_BLOCK];
+    std::pmr::monotonic_buffer_resource resource{block, sizeof block};
+    std::pmr::memory_resource* outerMemory;
+    RunArena* outerArena;
+
+public:
+    std::pmr::string text{&resource};
+
+    RunArena() : outerMemory(memory()), outerArena(active()) {
+        memory() = &resource;
+        active() = this;
+        text.reserve(256);
+    }
+    ~RunArena() {
+        memory() = outerMemory;
+        active() = outerArena;
+    }
+    RunArena(const RunArena&) = delete;
+    RunArena& operator=(const RunArena&) = delete;
+
+    static std::pmr::memory_resource*& memory() {
+        static std::pmr::memory_resource* current = std::pmr::new_delete_resource();
+        return current;
+    }
+    static RunArena*& active() {
+        static RunArena* current = nullptr;
+        return current;
+    }
+};
+
+// The current run's arena, or the heap outside one.
+inline std::pmr::memory_resource* runMemory() { return RunArena::memory(); }
+
+inline void appendPart(std::pmr::string& out, std::string_view part) { out.append(part); }
+inline void appendPart(std::pmr::string& out, char part) { out.push_back(part); }
+
+template <class T, std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, char>, int> = 0>
+void appendPart(std::pmr::string& out, T part) {
+    if constexpr (std::is_floating_point_v<T>) {
+        // to_chars for floating point is missing from older standard libraries.
+        out.append(std::to_string(part));
+    } else {
+        char digits[24];
+        out.append(digits, std::to_chars(digits, digits + sizeof digits, part).ptr);
+    }
+}
+
+// Concatenates the parts (strings, characters and numbers) into the run's
+// message buffer. The view is valid until the next call:
+//
+//   printStep(arr, stepText("Swapping ", arr[i], " and ", arr[j]), ...);
+template <class... Parts>
+std::string_view stepText(const Parts&... parts) {
+    static std::pmr::string fallback;
+    std::pmr::string& out = RunArena::active() ? RunArena::active()->text : fallback;
+    out.clear();
+    (appendPart(out, parts), ...);
+    return out;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// Cooperative limits for exponential-time searches. The server passes them
+// through the environment, like TRACE_MAX_RATE:
+//
+//   SEARCH_TIME_LIMIT_MS   stop after this much wall time
+//   SEARCH_NODE_LIMIT      stop after exploring this many nodes
+//   SEARCH_PROGRESS_MS     interval between progress records (default 1000)
+//   SEARCH_CANCEL_STDIN=1  stop when the line "cancel" arrives on stdin
+//
+// Search loops call BudgetTicker::tick once per node. It counts locally and
+// every BUDGET_CHECK_NODES nodes folds the count into the shared budget,
+// which checks the limits and writes at most one
+// {"type":"progress","nodes","depth","maxDepth","rate","elapsedMs"} record
+// per interval. A stopped search unwinds and reports its best partial
+// result; the binary then exits with EXIT_STOPPED so the server knows the
+// output is incomplete.
+
+const long long BUDGET_CHECK_NODES = 1024;
+const int EXIT_STOPPED = 3;
+
+enum class StopReason { None, Deadline, NodeLimit, Cancelled };
+
+class SearchBudget {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point began = Clock::now();
+    long long timeLimitMs = 0, nodeLimit = 0, progressMs = 1000;
+    std::atomic<long long> explored{0}, nextProgressMs{0};
+    std::atomic<int> deepest{0};
+    std::atomic<int> reason{(int)StopReason::None};
+    std::mutex printLock;
+
+    static long long envNumber(const char* name, long long fallback) {
+        const char* v = std::getenv(name);
+        return v && *v ? std::max(0LL, std::atoll(v)) : fallback;
+    }
+
+    long long elapsedMs() const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - began).count();
+    }
+
+public:
+    SearchBudget() {
+        timeLimitMs = envNumber("SEARCH_TIME_LIMIT_MS", 0);
+        nodeLimit = envNumber("SEARCH_NODE_LIMIT", 0);
+        progressMs = envNumber("SEARCH_PROGRESS_MS", 1000);
+        nextProgressMs = progressMs;
+        if (envNumber("SEARCH_CANCEL_STDIN", 0)) {
+            // Detached: a blocked read must not keep the process alive.
+            std::thread([this] {
+                for (std::string line; std::getline(std::cin, line);)
+                    if (line == "cancel" || line == "cancel\r") stop(StopReason::Cancelled);
+            }).detach();
+        }
+    }
+
+    bool stopped() const { return reason.load(std::memory_order_relaxed) != (int)StopReason::None; }
+    long long nodes() const { return explored.load(); }
+
+    void stop(StopReason why) {
+        int none = (int)StopReason::None;
+        reason.compare_exchange_strong(none, (int)why);
+    }
+
+    const char* stopReason() const {
+        switch ((StopReason)reason.load()) {
+            case StopReason::Deadline: return "deadline";
+            case StopReason::NodeLimit: return "node limit";
+            case StopReason::Cancelled: return "cancelled";
+            default: return "";
+        }
+    }
+
+    // Thread-safe; called every BUDGET_CHECK_NODES nodes per thread.
+    void add(long long batch, int depth) {
+        long long total = explored.fetch_add(batch) + batch;
+        int seen = deepest.load();
+        while (depth > seen && !deepest.compare_exchange_weak(seen, depth)) {}
+        if (nodeLimit && total >= nodeLimit) stop(StopReason::NodeLimit);
+        long long now = elapsedMs();
+        if (timeLimitMs && now >= timeLimitMs) stop(StopReason::Deadline);
+        long long due = nextProgressMs.load();
+        if (progressMs && now >= due && nextProgressMs.compare_exchange_strong(due, now + progressMs)) {
+            std::ostringstream out;
+            out << "{\"type\":\"progress\",\"nodes\":" << total << ",\"depth\":" << depth << ",\"maxDepth\":" << deepest.load()
+                << ",\"rate\":" << (now ? total * 1000 / now : 0) << ",\"elapsedMs\":" << now << "}";
+            std::lock_guard<std::mutex> lock(printLock);
+            std::cout << out.str() << std::endl;
+        }
+    }
+};
+
+inline SearchBudget& searchBudget() {
+    static SearchBudget budget;
+    return budget;
+}
+
+// One per searching thread.
+class BudgetTicker {
+    SearchBudget& budget;
+    long long pending = 0;
+
+public:
+    explicit BudgetTicker(SearchBudget& b = searchBudget()) : budget(b) {}
+    ~BudgetTicker() { flush(0); }
+
+    // Counts `count` nodes at `depth`; true once the search must stop.
+    bool tick(int depth, long long count = 1) {
+        pending += count;
+        if (pending >= BUDGET_CHECK_NODES) flush(depth);
+        return budget.stopped();
+    }
+
+    bool stopped() const { return budget.stopped(); }
+
+    void flush(int depth) {
+        if (pending) budget.add(pending, depth);
+        pending = 0;
+    }
+};
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Compressed sparse row graphs and their binary file format.
+//
+// On disk: a header, then the node labels (int32, ascending), the row
+// offsets (int64, n + 1), the arc targets and the arc weights (int32, m each).
+// Each section starts on a 64-byte boundary, so a read-only shared mapping of
+// the file is used in place: loading costs one mmap whatever the graph size,
+// and every process that maps the same file shares its page cache.
+//
+// Arcs address nodes by dense index 0..n-1; ids[i] is the label of node i.
+// Rows are sorted by (weight, target), so the arcs of a node lighter than any
+// threshold form a prefix of its row.
+
+const uint32_t GRAPH_FILE_VERSION = 1;
+const uint32_t GRAPH_UNDIRECTED = 1;        // every arc u->v has a twin v->u
+const char GRAPH_MAGIC[8] = {'C', 'S', 'R', 'G', 'R', 'A', 'P', 'H'};
+
+struct GraphFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t nodes, arcs;
+    uint64_t idsOffset, offsetsOffset, targetsOffset, weightsOffset, fileSize;
+};
+
+inline uint64_t graphAlignUp(uint64_t x) { return (x + 63) & ~63ULL; }
+
+inline GraphFileHeader graphLayoutFor(uint64_t n, uint64_t m, uint32_t flags) {
+    GraphFileHeader h{};
+    memcpy(h.magic, GRAPH_MAGIC, sizeof h.magic);
+    h.version = GRAPH_FILE_VERSION;
+    h.flags = flags;
+    h.nodes = n;
+    h.arcs = m;
+    h.idsOffset = graphAlignUp(sizeof(GraphFileHeader));
+    h.offsetsOffset = graphAlignUp(h.idsOffset + n * sizeof(int32_t));
+    h.targetsOffset = graphAlignUp(h.offsetsOffset + (n + 1) * sizeof(int64_t));
+    h.weightsOffset = graphAlignUp(h.targetsOffset + m * sizeof(int32_t));
+    h.fileSize = h.weightsOffset + m * sizeof(int32_t);
+    return h;
+}
+
+// Edges as parallel arrays, labelled by the caller's node ids.
+struct EdgeList {
+    std::vector<int32_t> from, to, weight;
+
+    void add(int32_t u, int32_t v, int32_t w) {
+        from.push_back(u);
+        to.push_back(v);
+        weight.push_back(w);
+    }
+    size_t size() const { return from.size(); }
+};
+
+// Reads "u v [w]" lines (w defaults to 1). Comment and header lines starting
+// with '#', '%', 'c' or 'p' are skipped, and a leading 'a' is accepted, so
+// SNAP edge lists and DIMACS .gr files load as they are. "-" reads stdin.
+inline std::string readEdgeList(const std::string& path, EdgeList& out) {
+    FILE* in = path == "-" ? stdin : fopen(path.c_str(), "rb");
+    if (!in) return "Cannot open " + path;
+    std::vector<char> buf(1 << 20);
+    std::string carry;
+    long long line = 0;
+    std::string error;
+
+    auto parseLine = [&](const char* p, const char* end) {
+        ++line;
+        while (p < end && (*p == ' ' || *p == '\t')) ++p;
+        if (p == end || *p == '\r' || *p == '#' || *p == '%' || *p == 'c' || *p == 'p') return;
+        if (*p == 'a') ++p;
+        long long v[3];
+        int k = 0;
+        while (p < end && k < 4) {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+            if (p == end) break;
+            bool neg = *p == '-';
+            if (neg) ++p;
+            if (p == end || *p < '0' || *p > '9' || k == 3) {
+                k = 4;
+                break;
+            }
+            long long x = 0;
+            while (p < end && *p >= '0' && *p <= '9') x = x * 10 + (*p++ - '0');
+            v[k++] = neg ? -x : x;
+        }
+        if (k < 2 || k > 3) {
+            if (error.empty()) error = "Line " + std::to_string(line) + ": expected u v [w]";
+            return;
+        }
+        out.add((int32_t)v[0], (int32_t)v[1], k == 3 ? (int32_t)v[2] : 1);
+    };
+
+    size_t got;
+    while (error.empty() && (got = fread(buf.data(), 1, buf.size(), in)) > 0) {
+        const char* p = buf.data();
+        const char* end = p + got;
+        for (const char* nl; (nl = (const char*)memchr(p, '\n', end - p)); p = nl + 1) {
+            if (carry.empty()) {
+                parseLine(p, nl);
+            } else {
+                carry.append(p, nl);
+                parseLine(carry.data(), carry.data() + carry.size());
+                carry.clear();
+            }
+        }
+        carry.append(p, end);
+    }
+    if (!carry.empty() && error.empty()) parseLine(carry.data(), carry.data() + carry.size());
+    if (in != stdin) fclose(in);
+    return error;
+}
+
+class CsrGraph {
+    std::vector<int32_t> ownedIds, ownedTargets, ownedWeights;
+    std::vector<int64_t> ownedOffsets;
+    const char* mapped = nullptr;
+    size_t mappedSize = 0;
+    std::vector<char> loaded;                   // fallback when mapping is unavailable
+
+public:
+    const int32_t* ids = nullptr;
+    const int64_t* offsets = nullptr;
+    const int32_t* targets = nullptr;
+    const int32_t* weights = nullptr;
+    int n = 0;
+    int64_t m = 0;
+    uint32_t flags = 0;
+
+    CsrGraph() = default;
+    CsrGraph(const CsrGraph&) = delete;
+    CsrGraph& operator=(const CsrGraph&) = delete;
+
+    ~CsrGraph() {
+#ifndef _WIN32
+        if (mapped) munmap((void*)mapped, mappedSize);
+#endif
+    }
+
+    int size() const { return n; }
+    bool undirected() const { return flags & GRAPH_UNDIRECTED; }
+    int32_t maxWeight() const { return m ? *std::max_element(weights, weights + m) : 0; }
+
+    // Dense index of a node label, or -1.
+    int index(int id) const {
+        const int32_t* it = std::lower_bound(ids, ids + n, id);
+        return it != ids + n && *it == id ? int(it - ids) : -1;
+    }
+
+    // With `undirected` every edge is stored in both directions.
+    void build(EdgeList edges, bool undirected) {
+        std::vector<int32_t>& labels = ownedIds;
+        labels.assign(edges.from.begin(), edges.from.end());
+        labels.insert(labels.end(), edges.to.begin(), edges.to.end());
+        std::sort(labels.begin(), labels.end());
+        labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+        labels.shrink_to_fit();
+        n = labels.size();
+
+        // Relabel through a table when the labels are dense enough, otherwise
+        // by binary search.
+        std::vector<int32_t> table;
+        int32_t low = n ? labels.front() : 0;
+        if (n && (int64_t)labels.back() - low < 4 * (int64_t)n + 1024) {
+            table.assign(labels.back() - low + 1, -1);
+            for (int i = 0; i < n; ++i) table[labels[i] - low] = i;
+        }
+        auto relabel = [&](std::vector<int32_t>& side) {
+            for (int32_t& x : side) x = table.empty() ? int32_t(std::lower_bound(labels.begin(), labels.end(), x) - labels.begin()) : table[x - low];
+        };
+        relabel(edges.from);
+        relabel(edges.to);
+
+        ownedOffsets.assign(n + 1, 0);
+        for (size_t e = 0; e < edges.size(); ++e) {
+            ++ownedOffsets[edges.from[e] + 1];
+            if (undirected) ++ownedOffsets[edges.to[e] + 1];
+        }
+        for (int i = 0; i < n; ++i) ownedOffsets[i + 1] += ownedOffsets[i];
+        m = ownedOffsets[n];
+
+        // Arcs are packed as (weight with the sign bit flipped, target) so a
+        // plain integer sort orders each row by weight, then target.
+        std::vector<uint64_t> packed(m);
+        std::vector<int64_t> fill(ownedOffsets.begin(), ownedOffsets.end() - 1);
+        auto pack = [](int32_t w, int32_t v) { return (uint64_t)((uint32_t)w ^ 0x80000000u) << 32 | (uint32_t)v; };
+        for (size_t e = 0; e < edges.size(); ++e) {
+            packed[fill[edges.from[e]]++] = pack(edges.weight[e], edges.to[e]);
+            if (undirected) packed[fill[edges.to[e]]++] = pack(edges.weight[e], edges.from[e]);
+        }
+        edges = EdgeList();
+        fill = std::vector<int64_t>();
+
+        ownedTargets.resize(m);
+        ownedWeights.resize(m);
+        for (int i = 0; i < n; ++i) {
+            std::sort(packed.begin() + ownedOffsets[i], packed.begin() + ownedOffsets[i + 1]);
+            for (int64_t a = ownedOffsets[i]; a < ownedOffsets[i + 1]; ++a) {
+                ownedTargets[a] = (int32_t)(uint32_t)packed[a];
+                ownedWeights[a] = (int32_t)((uint32_t)(packed[a] >> 32) ^ 0x80000000u);
+            }
+        }
+        flags = undirected ? GRAPH_UNDIRECTED : 0;
+        ids = ownedIds.data();
+        offsets = ownedOffsets.data();
+        targets = ownedTargets.data();
+        weights = ownedWeights.data();
+    }
+
+    bool save(const std::string& path) const {
+        GraphFileHeader h = graphLayoutFor(n, m, flags);
+        FILE* out = fopen(path.c_str(), "wb");
+        if (!out) return false;
+        auto writeAt = [&](uint64_t offset, const void* data, size_t bytes) {
+            static const char zeros[64] = {};
+            for (long pos = ftell(out); (uint64_t)pos < offset; pos = ftell(out))
+                fwrite(zeros, 1, std::min<uint64_t>(64, offset - pos), out);
+            fwrite(data, 1, bytes, out);
+        };
+        writeAt(0, &h, sizeof h);
+        writeAt(h.idsOffset, ids, (size_t)n * sizeof(int32_t));
+        writeAt(h.offsetsOffset, offsets, (size_t)(n + 1) * sizeof(int64_t));
+        writeAt(h.targetsOffset, targets, (size_t)m * sizeof(int32_t));
+        writeAt(h.weightsOffset, weights, (size_t)m * sizeof(int32_t));
+        bool ok = !ferror(out);
+        return fclose(out) == 0 && ok;
+    }
+
+    // Maps the file read-only and shared; only the header is checked, so the
+    // cost does not depend on the graph size. Returns an error message or "".
+    std::string load(const std::string& path) {
+        const char* base = nullptr;
+        size_t size = 0;
+#ifndef _WIN32
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(GraphFileHeader)) {
+            void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (p != MAP_FAILED) {
+                mapped = base = (const char*)p;
+                mappedSize = size = st.st_size;
+            }
+        }
+        if (fd >= 0) close(fd);
+#endif
+        if (!base) {
+            std::ifstream in(path, std::ios::binary);
+            if (!in) return "Cannot open " + path;
+            loaded.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            base = loaded.data();
+            size = loaded.size();
+        }
+
+        GraphFileHeader h;
+        if (size < sizeof h) return "Graph file is truncated";
+        memcpy(&h, base, sizeof h);
+        if (memcmp(h.magic, GRAPH_MAGIC, sizeof h.magic) != 0) return "Not a CSR graph file";
+        if (h.version != GRAPH_FILE_VERSION) return "Unsupported graph file version " + std::to_string(h.version);
+        GraphFileHeader expect = graphLayoutFor(h.nodes, h.arcs, h.flags);
+        if (h.nodes > INT32_MAX || memcmp(&h, &expect, sizeof h) != 0 || size < expect.fileSize)
+            return "Graph file is truncated";
+        n = h.nodes;
+        m = h.arcs;
+        flags = h.flags;
+        ids = (const int32_t*)(base + h.idsOffset);
+        offsets = (const int64_t*)(base + h.offsetsOffset);
+        targets = (const int32_t*)(base + h.targetsOffset);
+        weights = (const int32_t*)(base + h.weightsOffset);
+        if (offsets[0] != 0 || offsets[n] != m) return "Graph file is corrupt";
+        return "";
+    }
+};
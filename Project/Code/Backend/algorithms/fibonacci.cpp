@@ -1,10 +1,24 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <list>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include "trace.h"
+#include "stats.h"
 
 using namespace std;
+using namespace std::chrono;
 
-void logStep(int n, int result, const string& message, const vector<int>& prevIndices = {}) {
+const int TRACE_LIMIT = 92;                  // F(93) no longer fits in a signed 64-bit result
+const size_t CACHE_BYTES = 256u << 20;       // budget for cached big results and checkpoints
+const uint64_t NEAR_LIMIT = 1 << 16;         // max distance for the additive jump from a cached pair
+
+void logStep(int n, long long result, const string& message, const vector<int>& prevIndices = {}) {
+    if (!traceKeep(traceImportant(message))) return;
     cout << "{";
     cout << "\"type\":\"Fibonacci\", ";
     cout << "\"n\":" << n << ", ";
@@ -21,7 +35,7 @@ void logStep(int n, int result, const string& message, const vector<int>& prevIn
     cout << "}" << endl;
 }
 
-int fibonacci(int n) {
+long long fibonacci(int n) {
     if (n == 0) {
         logStep(0, 0, "Base case n = 0");
         return 0;
@@ -31,9 +45,9 @@ int fibonacci(int n) {
         return 1;
     }
 
-    int a = 0, b = 1;
+    long long a = 0, b = 1;
     for (int i = 2; i <= n; ++i) {
-        int temp = a + b;
+        long long temp = a + b;
         logStep(i, temp, "Fibonacci calculation", {i-2, i-1});
         a = b;
         b = temp;
@@ -42,15 +56,414 @@ int fibonacci(int n) {
     return b;
 }
 
+// Non-negative integer in base 10^9, least significant limb first, so the
+// decimal string of a multi-million digit result is a plain limb dump.
+struct BigInt {
+    static const uint32_t BASE = 1000000000;
+    vector<uint32_t> limbs;
+
+    BigInt(uint64_t v = 0) {
+        while (v) {
+            limbs.push_back(v % BASE);
+            v /= BASE;
+        }
+    }
+
+    void trim() {
+        while (!limbs.empty() && limbs.back() == 0) limbs.pop_back();
+    }
+
+    size_t bytes() const { return limbs.size() * sizeof(uint32_t) + sizeof(BigInt); }
+
+    string toString() const {
+        if (limbs.empty()) return "0";
+        string s = to_string(limbs.back());
+        char buf[16];
+        for (int i = (int)limbs.size() - 2; i >= 0; --i) {
+            snprintf(buf, sizeof(buf), "%09u", limbs[i]);
+            s += buf;
+        }
+        return s;
+    }
+};
+
+// a += b << (shift limbs)
+void addInto(vector<uint32_t>& a, const uint32_t* b, size_t bn, size_t shift = 0) {
+    if (a.size() < shift + bn + 1) a.resize(shift + bn + 1, 0);
+    uint32_t carry = 0;
+    size_t i = 0;
+    for (; i < bn || carry; ++i) {
+        uint32_t sum = a[shift + i] + carry + (i < bn ? b[i] : 0);
+        carry = sum >= BigInt::BASE;
+        a[shift + i] = carry ? sum - BigInt::BASE : sum;
+        if (shift + i + 1 == a.size() && carry) a.push_back(0);
+    }
+}
+
+// a -= b, requires a >= b
+void subFrom(vector<uint32_t>& a, const vector<uint32_t>& b) {
+    int64_t borrow = 0;
+    for (size_t i = 0; i < a.size() && (i < b.size() || borrow); ++i) {
+        int64_t d = (int64_t)a[i] - borrow - (i < b.size() ? b[i] : 0);
+        borrow = d < 0;
+        a[i] = (uint32_t)(borrow ? d + BigInt::BASE : d);
+    }
+}
+
+// Product scanning: each output column is summed in 128 bits and carried
+// once, instead of a division per limb product.
+void schoolbook(const uint32_t* a, size_t an, const uint32_t* b, size_t bn, vector<uint32_t>& out) {
+    out.assign(an + bn, 0);
+    unsigned __int128 acc = 0;
+    for (size_t k = 0; k + 1 < an + bn; ++k) {
+        size_t lo = k >= bn ? k - bn + 1 : 0, hi = min(k, an - 1);
+        uint64_t col = 0;
+        for (size_t i = lo; i <= hi; ++i) {
+            col += (uint64_t)a[i] * b[k - i];
+            if (col >= (1ULL << 63)) {
+                acc += col;
+                col = 0;
+            }
+        }
+        acc += col;
+        out[k] = (uint32_t)(acc % BigInt::BASE);
+        acc /= BigInt::BASE;
+    }
+    out[an + bn - 1] = (uint32_t)acc;
+}
+
+// Number-theoretic transform modulo an NTT-friendly prime (primitive root 3).
+uint32_t powMod(uint64_t b, uint64_t e, uint32_t p) {
+    uint64_t r = 1;
+    for (b %= p; e; e >>= 1, b = b * b % p)
+        if (e & 1) r = r * b % p;
+    return (uint32_t)r;
+}
+
+void ntt(vector<uint32_t>& a, uint32_t p, bool invert) {
+    size_t n = a.size();
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) swap(a[i], a[j]);
+    }
+    for (size_t len = 2; len <= n; len <<= 1) {
+        uint32_t w = powMod(3, (p - 1) / len, p);
+        if (invert) w = powMod(w, p - 2, p);
+        vector<uint32_t> roots(len / 2);
+        roots[0] = 1;
+        for (size_t k = 1; k < len / 2; ++k) roots[k] = (uint64_t)roots[k - 1] * w % p;
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t k = 0; k < len / 2; ++k) {
+                uint32_t u = a[i + k], v = (uint64_t)a[i + k + len / 2] * roots[k] % p;
+                a[i + k] = u + v >= p ? u + v - p : u + v;
+                a[i + k + len / 2] = u >= v ? u - v : u + p - v;
+            }
+        }
+    }
+    if (invert) {
+        uint64_t inv = powMod(n, p - 2, p);
+        for (auto& x : a) x = x * inv % p;
+    }
+}
+
+// Convolution under three primes, recombined with Garner's CRT. Their product
+// (~7.8e25) exceeds the largest column sum, 2^23 limbs * (10^9)^2.
+void nttMultiply(const uint32_t* a, size_t an, const uint32_t* b, size_t bn, vector<uint32_t>& out) {
+    static const uint32_t P[3] = {998244353, 167772161, 469762049};
+    size_t n = 1;
+    while (n < an + bn) n <<= 1;
+    vector<uint32_t> r[3];
+    for (int t = 0; t < 3; ++t) {
+        vector<uint32_t> fa(n, 0), fb(n, 0);
+        for (size_t i = 0; i < an; ++i) fa[i] = a[i] % P[t];
+        for (size_t i = 0; i < bn; ++i) fb[i] = b[i] % P[t];
+        ntt(fa, P[t], false);
+        ntt(fb, P[t], false);
+        for (size_t i = 0; i < n; ++i) fa[i] = (uint64_t)fa[i] * fb[i] % P[t];
+        ntt(fa, P[t], true);
+        r[t] = move(fa);
+    }
+    uint64_t inv01 = powMod(P[0], P[1] - 2, P[1]);
+    uint64_t inv02 = powMod(P[0], P[2] - 2, P[2]);
+    uint64_t inv12 = powMod(P[1], P[2] - 2, P[2]);
+    out.assign(an + bn, 0);
+    unsigned __int128 acc = 0;
+    for (size_t k = 0; k < an + bn; ++k) {
+        uint64_t x1 = r[0][k];
+        uint64_t x2 = (r[1][k] + P[1] - x1 % P[1]) % P[1] * inv01 % P[1];
+        uint64_t x3 = ((r[2][k] + P[2] - x1 % P[2]) % P[2] * inv02 % P[2] + P[2] - x2 % P[2]) % P[2] * inv12 % P[2];
+        acc += x1 + (unsigned __int128)x2 * P[0] + (unsigned __int128)x3 * P[0] * P[1];
+        out[k] = (uint32_t)(acc % BigInt::BASE);
+        acc /= BigInt::BASE;
+    }
+}
+
+void karatsuba(const uint32_t* a, size_t an, const uint32_t* b, size_t bn, vector<uint32_t>& out) {
+    if (an < bn) return karatsuba(b, bn, a, an, out);
+    if (bn < 48) return schoolbook(a, an, b, bn, out);
+    if (bn >= 4096 && an + bn <= (1u << 23)) {
+        nttMultiply(a, an, b, bn, out);
+        while (!out.empty() && out.back() == 0) out.pop_back();
+        return;
+    }
+
+    size_t h = an / 2;
+    if (bn <= h) {
+        // Unbalanced: split only the longer operand.
+        vector<uint32_t> lo, hi;
+        karatsuba(a, h, b, bn, lo);
+        karatsuba(a + h, an - h, b, bn, hi);
+        out = move(lo);
+        addInto(out, hi.data(), hi.size(), h);
+    } else {
+        vector<uint32_t> z0, z1, z2;
+        karatsuba(a, h, b, h, z0);
+        karatsuba(a + h, an - h, b + h, bn - h, z2);
+        vector<uint32_t> sa(a, a + h), sb(b, b + h);
+        addInto(sa, a + h, an - h);
+        addInto(sb, b + h, bn - h);
+        karatsuba(sa.data(), sa.size(), sb.data(), sb.size(), z1);
+        subFrom(z1, z0);
+        subFrom(z1, z2);
+        out = move(z0);
+        addInto(out, z1.data(), z1.size(), h);
+        addInto(out, z2.data(), z2.size(), 2 * h);
+    }
+    while (!out.empty() && out.back() == 0) out.pop_back();
+}
+
+BigInt operator*(const BigInt& a, const BigInt& b) {
+    BigInt r;
+    if (a.limbs.empty() || b.limbs.empty()) return r;
+    karatsuba(a.limbs.data(), a.limbs.size(), b.limbs.data(), b.limbs.size(), r.limbs);
+    r.trim();
+    return r;
+}
+
+BigInt operator+(BigInt a, const BigInt& b) {
+    addInto(a.limbs, b.limbs.data(), b.limbs.size());
+    a.trim();
+    return a;
+}
+
+BigInt operator-(BigInt a, const BigInt& b) {
+    subFrom(a.limbs, b.limbs);
+    a.trim();
+    return a;
+}
+
+// Thread-safe LRU bounded by the total cost of its values.
+template <typename Key, typename Value>
+class LRUCache {
+    using Entry = pair<Key, Value>;
+    list<Entry> order;
+    map<Key, typename list<Entry>::iterator> index;
+    size_t used = 0, capacity;
+    size_t (*cost)(const Value&);
+    mutex mtx;
+
+public:
+    LRUCache(size_t capacity, size_t (*cost)(const Value&)) : capacity(capacity), cost(cost) {}
+
+    bool get(const Key& key, Value& out) {
+        lock_guard<mutex> lock(mtx);
+        auto it = index.find(key);
+        if (it == index.end()) return false;
+        order.splice(order.begin(), order, it->second);
+        out = it->second->second;
+        return true;
+    }
+
+    // Entry with the greatest key <= key.
+    bool floor(const Key& key, Key& foundKey, Value& out) {
+        lock_guard<mutex> lock(mtx);
+        auto it = index.upper_bound(key);
+        if (it == index.begin()) return false;
+        --it;
+        order.splice(order.begin(), order, it->second);
+        foundKey = it->first;
+        out = it->second->second;
+        return true;
+    }
+
+    void put(const Key& key, const Value& value) {
+        lock_guard<mutex> lock(mtx);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            used -= cost(it->second->second);
+            order.erase(it->second);
+            index.erase(it);
+        }
+        size_t c = cost(value);
+        if (c > capacity) return;
+        order.emplace_front(key, value);
+        index[key] = order.begin();
+        used += c;
+        while (used > capacity) {
+            used -= cost(order.back().second);
+            index.erase(order.back().first);
+            order.pop_back();
+        }
+    }
+};
+
+using ExactPair = pair<BigInt, BigInt>;                        // (F(k), F(k+1))
+using ModPair = pair<uint64_t, uint64_t>;
+
+size_t exactCost(const ExactPair& p) { return p.first.bytes() + p.second.bytes() + 64; }
+size_t modCost(const ModPair&) { return 64; }
+
+LRUCache<uint64_t, ExactPair> exactCache(CACHE_BYTES, exactCost);
+LRUCache<pair<uint64_t, uint64_t>, ModPair> modCache(1u << 20, modCost);
+
+uint64_t mulMod(uint64_t a, uint64_t b, uint64_t m) { return (unsigned __int128)a * b % m; }
+// a + b mod m for a, b < m; the sum may pass 2^64 when m > 2^63.
+uint64_t addMod(uint64_t a, uint64_t b, uint64_t m) {
+    uint64_t r = a + b;
+    return r < a || r >= m ? r - m : r;
+}
+
+// Fast doubling: F(2k) = F(k) * (2F(k+1) - F(k)), F(2k+1) = F(k)^2 + F(k+1)^2.
+// The doubling chain for n visits every prefix n >> s of its binary form, and
+// those pairs are cached, so a query sharing high bits with an earlier one
+// resumes from the deepest cached prefix instead of starting from F(0).
+template <typename Pair, typename Lookup, typename Store, typename Step>
+Pair doublingChain(uint64_t n, Pair base, Lookup lookup, Store store, Step step, string& source) {
+    int bits = 64 - __builtin_clzll(n | 1);
+    int s = 0;
+    Pair cur = base;
+    source = "miss";
+    for (; s <= bits; ++s) {
+        if (lookup(n >> s, cur)) {
+            source = s == 0 ? "hit" : "checkpoint";
+            break;
+        }
+    }
+    if (s > bits) {
+        cur = base;
+        s = bits;
+    }
+    for (--s; s >= 0; --s) {
+        cur = step(cur, (n >> s) & 1);
+        // Only the last few levels hold large values; they are what nearby queries reuse.
+        if (s < 8) store(n >> s, cur);
+    }
+    return cur;
+}
+
+ExactPair doublingExact(uint64_t n, string& source) {
+    return doublingChain(
+        n, ExactPair(BigInt(0), BigInt(1)),
+        [](uint64_t k, ExactPair& out) { return exactCache.get(k, out); },
+        [](uint64_t k, const ExactPair& v) { exactCache.put(k, v); },
+        [](const ExactPair& cur, bool odd) {
+            const BigInt& a = cur.first;
+            const BigInt& b = cur.second;
+            BigInt c = a * (b + b - a);
+            BigInt d = a * a + b * b;
+            return odd ? ExactPair(d, c + d) : ExactPair(move(c), move(d));
+        },
+        source);
+}
+
+BigInt fibonacciExact(uint64_t n, string& source) {
+    ExactPair p;
+    if (exactCache.get(n, p)) {
+        source = "hit";
+        return p.first;
+    }
+    // Nearby query: F(k+d) = F(k+1)F(d) + F(k)F(d-1). F(d) is small for small d,
+    // so the jump from a cached pair is linear in the size of the result.
+    uint64_t k;
+    if (exactCache.floor(n, k, p) && n - k <= NEAR_LIMIT) {
+        string ignored;
+        uint64_t d = n - k;
+        ExactPair small = doublingExact(d - 1, ignored);         // (F(d-1), F(d))
+        BigInt next = small.first + small.second;                 // F(d+1)
+        ExactPair result(p.second * small.second + p.first * small.first,
+                         p.second * next + p.first * small.second);
+        exactCache.put(n, result);
+        source = "nearby";
+        return result.first;
+    }
+    return doublingExact(n, source).first;
+}
+
+uint64_t fibonacciMod(uint64_t n, uint64_t m, string& source) {
+    ModPair p = doublingChain(
+        n, ModPair(0, 1 % m),
+        [m](uint64_t k, ModPair& out) { return modCache.get({k, m}, out); },
+        [m](uint64_t k, const ModPair& v) { modCache.put({k, m}, v); },
+        [m](const ModPair& cur, bool odd) {
+            uint64_t a = cur.first, b = cur.second;
+            uint64_t c = mulMod(a, (2 * (unsigned __int128)b + m - a) % m, m);
+            uint64_t d = addMod(mulMod(a, a, m), mulMod(b, b, m), m);
+            return odd ? ModPair(d, addMod(c, d, m)) : ModPair(c, d);
+        },
+        source);
+    return p.first;
+}
+
+void logQuery(uint64_t n, const string& result, const string& source, long long micros, uint64_t mod = 0) {
+    cout << "{";
+    cout << "\"type\":\"Fibonacci\", ";
+    cout << "\"n\":" << n << ", ";
+    if (mod) cout << "\"mod\":" << mod << ", ";
+    cout << "\"digits\":" << result.size() << ", ";
+    cout << "\"cache\":\"" << source << "\", ";
+    cout << "\"micros\":" << micros << ", ";
+    cout << "\"cacheable\":false, ";       // timed: a replay would show stale micros
+    cout << "\"result\":\"" << result << "\"";
+    cout << "}" << endl;
+}
+
+void answer(uint64_t n, uint64_t mod) {
+    auto start = steady_clock::now();
+    string source, result;
+    if (mod) result = to_string(fibonacciMod(n, mod, source));
+    else result = fibonacciExact(n, source).toString();
+    long long micros = duration_cast<microseconds>(steady_clock::now() - start).count();
+    logQuery(n, result, source, micros, mod);
+}
+
 int main(int argc, char* argv[]) {
-    int n = 10; 
+    string mode = argc > 1 ? argv[1] : "";
+    StatsReport report(mode == "mod" || mode == "exact" || mode == "serve" ? "fibonacci-" + mode : "fibonacci");
+
+    if (mode == "mod" && argc > 3) {
+        answer(stoull(argv[2]), stoull(argv[3]));
+        return 0;
+    }
+    if (mode == "exact") {
+        for (int i = 2; i < argc; ++i) answer(stoull(argv[i]), 0);
+        return 0;
+    }
+    if (mode == "serve") {
+        // One query per line: "n" for the exact value, "n m" for F(n) mod m.
+        string line;
+        while (getline(cin, line)) {
+            uint64_t n = 0, m = 0;
+            if (sscanf(line.c_str(), "%llu %llu", (unsigned long long*)&n, (unsigned long long*)&m) < 1) continue;
+            answer(n, m);
+        }
+        return 0;
+    }
+
+    int n = 10;
 
     if (argc > 1) {
-        n = stoi(argv[1]);  
+        n = stoi(argv[1]);
+    }
+
+    if (n > TRACE_LIMIT) {
+        answer(n, 0);
+        return 0;
     }
 
     logStep(n, 1, "Starting Fibonacci calculation");
-    int result = fibonacci(n);
+    long long result = fibonacci(n);
     logStep(n, result, "Fibonacci complete");
 
     return 0;
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+#include "csr_graph.h"
+
+// Seeded synthetic graphs for scaling studies. Every generator returns an
+// undirected EdgeList (build it with CsrGraph::build(edges, true)); the same
+// kind, size, weights and seed always give the same graph. Nodes left without
+// edges (common in R-MAT) do not appear in the built graph.
+//
+//   rmat      R-MAT / Kronecker, 2^ceil(log2 n) nodes, skewed power-law degrees
+//   er        Erdos-Renyi G(n, m): m uniform random edges
+//   grid      2-D grid, 4-neighbour: high diameter, road-network-like
+//   complete  every pair once; meant for small n
+
+struct WeightGen {
+    std::string kind = "uniform";               // uniform | unit | exponential
+    int maxWeight = 1000;
+
+    bool valid() const { return (kind == "uniform" || kind == "unit" || kind == "exponential") && maxWeight >= 1; }
+
+    int32_t operator()(std::mt19937_64& rng) const {
+        if (kind == "unit") return 1;
+        if (kind == "exponential") {
+            // Mean maxWeight / 8, clipped: many cheap edges, a few expensive ones.
+            double u = (rng() >> 11) * 0x1.0p-53;
+            return (int32_t)std::min<double>(maxWeight, 1 + std::floor(-std::log1p(-u) * maxWeight / 8));
+        }
+        return 1 + (int32_t)(rng() % (uint64_t)maxWeight);
+    }
+};
+
+// R-MAT with the Graph500 quadrant probabilities; labels are shuffled so the
+// high-degree nodes are not clustered at small ids.
+inline EdgeList rmatGraph(int scale, long long edges, const WeightGen& weight, uint64_t seed) {
+    const double a = 0.57, b = 0.19, c = 0.19;
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    int n = 1 << scale;
+    std::vector<int32_t> label(n);
+    std::iota(label.begin(), label.end(), 0);
+    std::shuffle(label.begin(), label.end(), rng);
+    EdgeList out;
+    for (long long e = 0; e < edges; ++e) {
+        int32_t u = 0, v = 0;
+        for (int bit = 0; bit < scale; ++bit) {
+            double r = coin(rng);
+            u = u << 1 | (r >= a + b);
+            v = v << 1 | ((r >= a && r < a + b) || r >= a + b + c);
+        }
+        out.add(label[u], label[v], weight(rng));
+    }
+    return out;
+}
+
+inline EdgeList erdosRenyiGraph(int n, long long edges, const WeightGen& weight, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    EdgeList out;
+    for (long long e = 0; e < edges; ++e) {
+        int32_t u = rng() % n, v = rng() % n;
+        if (u == v) {
+            --e;
+            continue;
+        }
+        out.add(u, v, weight(rng));
+    }
+    return out;
+}
+
+inline EdgeList gridGraph(int rows, int cols, const WeightGen& weight, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    EdgeList out;
+    for (int r = 0; r < rows; ++r)
+        for (int c = 0; c < cols; ++c) {
+            int u = r * cols + c;
+            if (c + 1 < cols) out.add(u, u + 1, weight(rng));
+            if (r + 1 < rows) out.add(u, u + cols, weight(rng));
+        }
+    return out;
+}
+
+inline EdgeList completeGraph(int n, const WeightGen& weight, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    EdgeList out;
+    for (int u = 0; u < n; ++u)
+        for (int v = u + 1; v < n; ++v) out.add(u, v, weight(rng));
+    return out;
+}
+
+const long long GENERATE_MAX_EDGES = 1LL << 31;
+const int COMPLETE_MAX_NODES = 1 << 13;
+
+// About n nodes with average degree `degree` (rmat and er). Returns an error
+// message for unknown kinds or sizes out of range.
+inline std::string generateGraph(const std::string& kind, long long n, int degree, const WeightGen& weight,
+                                 uint64_t seed, EdgeList& out) {
+    if (!weight.valid()) return "Weights must be uniform, unit or exponential with maxWeight >= 1";
+    if (n < 2 || n > INT32_MAX / 2) return "Node count out of range";
+    long long edges = n * std::max(1, degree) / 2;
+    if (edges > GENERATE_MAX_EDGES) return "Too many edges";
+    if (kind == "rmat") {
+        int scale = 1;
+        while ((1LL << scale) < n) ++scale;
+        out = rmatGraph(scale, (1LL << scale) * std::max(1, degree) / 2, weight, seed);
+    } else if (kind == "er") {
+        out = erdosRenyiGraph((int)n, edges, weight, seed);
+    } else if (kind == "grid") {
+        int side = (int)std::ceil(std::sqrt((double)n));
+        out = gridGraph(side, side, weight, seed);
+    } else if (kind == "complete") {
+        if (n > COMPLETE_MAX_NODES) return "complete graphs are limited to " + std::to_string(COMPLETE_MAX_NODES) + " nodes";
+        out = completeGraph((int)n, weight, seed);
+    } else {
+        return "Unknown graph kind " + kind + " (rmat, er, grid, complete)";
+    }
+    return "";
+}
@@ -1,10 +1,22 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "trace.h"
+#include "stats.h"
+#include "budget.h"
 
 using namespace std;
 
+const int HELD_KARP_LIMIT = 25;
+
 void logStep(const vector<vector<int>>& graph, const vector<int>& path, int vertex, const string& message) {
+    if (!traceKeep(traceImportant(message))) return;
     cout << "{";
     cout << "\"type\":\"Hamiltonian Cycle\", ";
     cout << "\"message\":\"" << message << "\", ";
@@ -29,63 +41,293 @@ void logStep(const vector<vector<int>>& graph, const vector<int>& path, int vert
     cout << "}" << endl;
 }
 
-bool isSafe(int v, const vector<vector<int>>& graph, const vector<int>& path, int pos) {
-    if (graph[path[pos - 1]][v] == 0) return false;
-    for (int i = 0; i < pos; ++i) if (path[i] == v) return false;
-    return true;
-}
+// Search state over up to 64 vertices: adjacency rows and the visited set are
+// bitmasks, so membership is a bit test instead of a scan of path.
+struct HamSearch {
+    const vector<vector<int>>& graph;
+    int n;
+    vector<uint64_t> adj;
+    bool trace;
+    const atomic<bool>* stop = nullptr;
+    BudgetTicker* ticker = nullptr;
+    vector<int> best;                       // longest path seen, the partial result of a stopped search
+    int bestLen = 0;
+    vector<int> disc, low;
+    int timer = 0;
 
-bool hamCycleUtil(const vector<vector<int>>& graph, vector<int>& path, int pos) {
-    if (pos == graph.size()) {
-        if (graph[path[pos - 1]][path[0]] == 1) {
-            logStep(graph, path, -1, " Hamiltonian Cycle found");
-            return true;
-        } else {
-            logStep(graph, path, -1, "No cycle, backtracking");
-            return false;
+    HamSearch(const vector<vector<int>>& g, bool trace) : graph(g), n(g.size()), adj(n, 0), trace(trace), disc(n), low(n) {
+        for (int i = 0; i < n; ++i)
+            for (int j = 0; j < n; ++j)
+                if (i != j && graph[i][j]) adj[i] |= 1ULL << j;
+    }
+
+    // Tarjan bridge search from u inside the vertex set `live`, skipping the
+    // direct edge between the path end and the start. Returns whether the
+    // subtree below u contains vertex 0; fails if some bridge cuts off a
+    // subtree without it, since the path would have to cross that bridge twice.
+    bool bridgeWalk(int u, int parent, uint64_t live, int cur, bool& ok, uint64_t& seen) {
+        disc[u] = low[u] = ++timer;
+        seen |= 1ULL << u;
+        bool hasStart = u == 0;
+        uint64_t nbrs = adj[u] & live;
+        if (u == cur) nbrs &= ~1ULL;
+        if (u == 0) nbrs &= ~(1ULL << cur);
+        for (; nbrs && ok; nbrs &= nbrs - 1) {
+            int w = __builtin_ctzll(nbrs);
+            if (w == parent) continue;
+            if (disc[w]) {
+                low[u] = min(low[u], disc[w]);
+                continue;
+            }
+            bool childStart = bridgeWalk(w, u, live, cur, ok, seen);
+            low[u] = min(low[u], low[w]);
+            if (low[w] > disc[u] && !childStart) ok = false;
+            hasStart |= childStart;
         }
+        return hasStart;
     }
 
-    for (int v = 1; v < graph.size(); ++v) {
-        if (isSafe(v, graph, path, pos)) {
+    // Necessary conditions for extending the path cur ... through every
+    // unvisited vertex back to 0. Returns an empty string when the branch
+    // survives, otherwise the reason it was pruned.
+    string prune(uint64_t visited, int cur) {
+        uint64_t full = n == 64 ? ~0ULL : (1ULL << n) - 1;
+        uint64_t remaining = full & ~visited;
+        if (!remaining || n < 3) return "";
+        uint64_t ends = (1ULL << cur) | 1ULL;
+        if (!(adj[cur] & remaining)) return "dead end at vertex " + to_string(cur);
+        if (!(adj[0] & remaining)) return "start vertex cut off";
+        for (uint64_t r = remaining; r; r &= r - 1) {
+            int v = __builtin_ctzll(r);
+            if (__builtin_popcountll(adj[v] & (remaining | ends)) < 2)
+                return "vertex " + to_string(v) + " has fewer than two free neighbours";
+        }
+        uint64_t live = remaining | ends, seen = 0;
+        for (uint64_t r = live; r; r &= r - 1) disc[__builtin_ctzll(r)] = 0;
+        timer = 0;
+        bool ok = true;
+        bridgeWalk(cur, -1, live, cur, ok, seen);
+        if (seen != live) return "remaining graph is disconnected";
+        if (!ok) return "bridge would have to be crossed twice";
+        return "";
+    }
+
+    bool dfs(vector<int>& path, uint64_t visited, int pos) {
+        int cur = path[pos - 1];
+        if (pos > bestLen) {
+            bestLen = pos;
+            best = path;
+        }
+        if (pos == n) {
+            // With one vertex the closing edge is its self-loop, which adj leaves out.
+            if (n == 1 ? graph[0][0] != 0 : (adj[cur] & 1ULL) != 0) {
+                if (trace) logStep(graph, path, -1, " Hamiltonian Cycle found");
+                return true;
+            }
+            if (trace) logStep(graph, path, -1, "No cycle, backtracking");
+            return false;
+        }
+        if (stop && *stop) return false;
+        if (ticker && ticker->tick(pos)) return false;
+        if (trace) statAdd(Stat::Nodes);
+
+        for (uint64_t cand = adj[cur] & ~visited & ~1ULL; cand; cand &= cand - 1) {
+            int v = __builtin_ctzll(cand);
             path[pos] = v;
-            logStep(graph, path, v, "Trying vertex " + to_string(v));
-            if (hamCycleUtil(graph, path, pos + 1)) return true;
+            if (trace) logStep(graph, path, v, "Trying vertex " + to_string(v));
+            string reason = prune(visited | (1ULL << v), v);
+            if (reason.empty()) {
+                if (dfs(path, visited | (1ULL << v), pos + 1)) return true;
+                if (ticker && ticker->stopped()) return false;
+            } else if (trace) {
+                logStep(graph, path, v, "Pruned: " + reason);
+            }
             path[pos] = -1;
-            logStep(graph, path, v, "Backtracking from vertex " + to_string(v));
+            if (trace) logStep(graph, path, v, "Backtracking from vertex " + to_string(v));
         }
+        return false;
     }
-    return false;
+};
+
+// Partial result of a search stopped by its budget: the longest path found.
+void logStopped(const vector<vector<int>>& graph, const vector<int>& longest) {
+    SearchBudget& budget = searchBudget();
+    int covered = count_if(longest.begin(), longest.end(), [](int v) { return v >= 0; });
+    vector<int> path = longest.empty() ? vector<int>(graph.size(), -1) : longest;
+    logStep(graph, path, -1, "Search stopped (" + string(budget.stopReason()) + ") after " + to_string(budget.nodes())
+            + " nodes; longest path covers " + to_string(covered) + " of " + to_string(graph.size()) + " vertices");
 }
 
 void findHamiltonianCycle(const vector<vector<int>>& graph) {
     vector<int> path(graph.size(), -1);
     path[0] = 0;
     logStep(graph, path, 0, "Starting Hamiltonian cycle search");
-    if (!hamCycleUtil(graph, path, 1)) {
-        logStep(graph, path, -1, "No Hamiltonian Cycle found");
+    HamSearch search(graph, true);
+    BudgetTicker ticker;
+    search.ticker = &ticker;
+    string reason = graph.size() > 1 ? search.prune(1ULL, 0) : "";
+    if (!reason.empty() || !search.dfs(path, 1ULL, 1)) {
+        if (ticker.stopped()) logStopped(graph, search.best);
+        else logStep(graph, path, -1, "No Hamiltonian Cycle found");
+    }
+}
+
+// Second-vertex split: each neighbour of vertex 0 seeds an independent pruned
+// search; workers pull seeds from a shared counter and the first cycle found
+// stops the others. `longest` receives the longest path any worker reached.
+vector<int> parallelHamiltonianCycle(const vector<vector<int>>& graph, int threads, vector<int>& longest) {
+    int n = graph.size();
+    HamSearch probe(graph, false);
+    vector<int> seeds;
+    for (uint64_t c = probe.adj[0]; c; c &= c - 1) seeds.push_back(__builtin_ctzll(c));
+
+    atomic<size_t> next{0};
+    atomic<bool> found{false};
+    mutex resultLock;
+    vector<int> result;
+
+    auto worker = [&]() {
+        HamSearch search(graph, false);
+        BudgetTicker ticker;
+        search.stop = &found;
+        search.ticker = &ticker;
+        vector<int> path(n, -1);
+        path[0] = 0;
+        for (size_t i; !found && !ticker.stopped() && (i = next++) < seeds.size(); ) {
+            int v = seeds[i];
+            path[1] = v;
+            uint64_t visited = 1ULL | (1ULL << v);
+            if (!search.prune(visited, v).empty()) continue;
+            if (search.dfs(path, visited, 2) && !found.exchange(true)) {
+                lock_guard<mutex> lock(resultLock);
+                result = path;
+            }
+        }
+        lock_guard<mutex> lock(resultLock);
+        if (search.bestLen > (int)count_if(longest.begin(), longest.end(), [](int v) { return v >= 0; })) longest = search.best;
+    };
+
+    vector<thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+    return result;
+}
+
+// The dp and parallel modes' answer for one vertex, matching the search: a
+// cycle exactly when the vertex has a self-loop.
+vector<int> singleVertexCycle(const vector<vector<int>>& graph) {
+    return graph[0][0] ? vector<int>{0} : vector<int>{};
+}
+
+// Held-Karp over subsets of vertices 1..n-1: reach[mask] holds, as a bitmask,
+// every vertex v in mask such that some path 0 -> ... -> v visits exactly mask.
+vector<int> heldKarpCycle(const vector<vector<int>>& graph) {
+    int n = graph.size();
+    HamSearch probe(graph, false);
+    const vector<uint64_t>& adj = probe.adj;
+    int m = n - 1;
+    vector<uint32_t> reach(1u << m, 0);
+    auto vbit = [](int v) { return 1u << (v - 1); };
+
+    BudgetTicker ticker;
+    const uint32_t CHECK_MASKS = 4096;
+    for (int v = 1; v < n; ++v)
+        if (adj[0] >> v & 1) reach[vbit(v)] = vbit(v);
+    for (uint32_t mask = 1; mask < (1u << m); ++mask) {
+        if (mask % CHECK_MASKS == 0 && ticker.tick(__builtin_popcount(mask), CHECK_MASKS)) return {};
+        if (__builtin_popcount(mask) < 2) continue;
+        uint32_t ends = 0;
+        for (uint32_t r = mask; r; r &= r - 1) {
+            int v = __builtin_ctz(r) + 1;
+            uint32_t prevEnds = reach[mask ^ vbit(v)];
+            if (prevEnds & (uint32_t)(adj[v] >> 1)) ends |= vbit(v);
+        }
+        reach[mask] = ends;
+    }
+    statAdd(Stat::DpCells, 1LL << m);
+
+    uint32_t full = (1u << m) - 1;
+    int last = -1;
+    for (uint32_t r = reach[full]; r; r &= r - 1) {
+        int v = __builtin_ctz(r) + 1;
+        if (adj[v] & 1ULL) {
+            last = v;
+            break;
+        }
+    }
+    if (last < 0) return {};
+
+    vector<int> path(n, -1);
+    path[0] = 0;
+    uint32_t mask = full;
+    for (int pos = n - 1, v = last; pos >= 1; --pos) {
+        path[pos] = v;
+        mask ^= vbit(v);
+        uint32_t options = reach[mask] & (uint32_t)(adj[v] >> 1);
+        if (options) v = __builtin_ctz(options) + 1;
     }
+    return path;
+}
+
+vector<vector<int>> parseGraph(int argc, char* argv[], int start) {
+    int count = argc - start;
+    int n = (int)llround(sqrt((double)count));
+    if (count < 1 || n * n != count || n > 64) return {};
+    vector<vector<int>> graph(n, vector<int>(n, 0));
+    for (int i = 0; i < count; ++i) graph[i / n][i % n] = stoi(argv[start + i]) != 0;
+    for (int i = 0; i < n; ++i)
+        for (int j = 0; j < n; ++j)
+            graph[i][j] = graph[j][i] = graph[i][j] | graph[j][i];
+    return graph;
 }
 
 int main(int argc, char* argv[]) {
+    string mode = "search";
+    int first = 1;
+    if (argc > 1 && (string(argv[1]) == "dp" || string(argv[1]) == "parallel")) {
+        mode = argv[1];
+        first = 2;
+    }
+
+    StatsReport report(mode == "search" ? "hamiltonian_cycle" : "hamiltonian_cycle-" + mode);
+    SearchBudget& budget = searchBudget();
     vector<vector<int>> graph = {
-        // {0, 1, 0, 1},
-        // {1, 0, 1, 1},
-        // {0, 1, 0, 1},
-        // {1, 1, 1, 0},
-        {0, 1, 1, 1, 1, 1, 1, 1, 1, 1},
-        {1, 0, 1, 1, 1, 1, 1, 1, 1, 1},
-        {1, 1, 0, 1, 1, 1, 1, 1, 1, 1},
-        {1, 1, 1, 0, 1, 1, 1, 1, 1, 0},
-        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-       
-        
+        {0, 1, 0, 1},
+        {1, 0, 1, 1},
+        {0, 1, 0, 1},
+        {1, 1, 1, 0},
     };
-    
-    if (argc > 1) {
+
+    if (argc > first) {
+        graph = parseGraph(argc, argv, first);
+        if (graph.empty()) {
+            cout << "{\"type\":\"error\",\"message\":\"Expected a flattened N x N adjacency matrix (N <= 64)\"}" << endl;
+            return 1;
+        }
+    }
+
+    if (mode == "search") {
+        findHamiltonianCycle(graph);
+        return budget.stopped() ? EXIT_STOPPED : 0;
+    }
+
+    vector<int> cycle, longest;
+    if (mode == "dp") {
+        if ((int)graph.size() > HELD_KARP_LIMIT) {
+            cout << "{\"type\":\"error\",\"message\":\"Held-Karp mode supports at most " << HELD_KARP_LIMIT << " vertices\"}" << endl;
+            return 1;
+        }
+        cycle = graph.size() == 1 ? singleVertexCycle(graph) : heldKarpCycle(graph);
+    } else {
+        cycle = graph.size() == 1 ? singleVertexCycle(graph) : parallelHamiltonianCycle(graph, max(1u, thread::hardware_concurrency()), longest);
     }
 
-    findHamiltonianCycle(graph);
-    return 0;
+    if (!cycle.empty())
+        logStep(graph, cycle, -1, " Hamiltonian Cycle found");
+    else if (budget.stopped())
+        logStopped(graph, longest);
+    else
+        logStep(graph, vector<int>(graph.size(), -1), -1, "No Hamiltonian Cycle found");
+    return cycle.empty() && budget.stopped() ? EXIT_STOPPED : 0;
 }
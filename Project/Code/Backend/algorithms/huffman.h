@@ -0,0 +1,341 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Byte-wise Huffman coding with canonical, length-limited codes.
+//
+// Code lengths come from the two-queue construction: the used symbols sorted
+// by count in one queue, merged nodes in a second one, which they enter in
+// nondecreasing weight order, so the two lightest nodes are always at the
+// queue fronts and the tree is built in linear time after the sort. Lengths
+// are then capped at HUFFMAN_MAX_BITS (see limitHuffmanLengths), and the
+// codes are the canonical ones for those lengths, so a file only needs to
+// store the 256 lengths.
+//
+// Bits are written LSB first, so the decoder reads the next
+// HUFFMAN_MAX_BITS bits of a 64-bit bit buffer as one index into a table
+// that yields up to four whole symbols per lookup.
+//
+// File layout (little-endian): "HUF1", the uint64 original size, one length
+// byte per symbol (0 = absent), then the code bits, padded to a byte.
+
+const int HUFFMAN_MAX_BITS = 12;
+const int HUFFMAN_TABLE_SIZE = 1 << HUFFMAN_MAX_BITS;
+const int HUFFMAN_MAX_SYMBOLS = 4;          // decoded per table lookup at most
+const size_t HUFFMAN_CHUNK = 1 << 20;
+const char HUFFMAN_MAGIC[4] = {'H', 'U', 'F', '1'};
+
+using ByteHistogram = std::array<uint64_t, 256>;
+using CodeLengths = std::array<uint8_t, 256>;
+
+// One step of the construction, for the tracer. Nodes are symbols 0..255
+// and merged nodes 256, 257, ... in creation order.
+struct HuffmanMerge {
+    int left, right, node;
+    uint64_t weight;
+};
+
+inline CodeLengths huffmanLengths(const ByteHistogram& counts, std::vector<HuffmanMerge>* merges = nullptr) {
+    CodeLengths lengths{};
+    std::vector<int> leaves;
+    for (int s = 0; s < 256; ++s)
+        if (counts[s]) leaves.push_back(s);
+    if (leaves.size() == 1) lengths[leaves[0]] = 1;
+    if (leaves.size() < 2) return lengths;
+    std::sort(leaves.begin(), leaves.end(), [&](int a, int b) { return counts[a] != counts[b] ? counts[a] < counts[b] : a < b; });
+
+    // Node i < L is leaves[i], node L + k the k-th merge; a parent always
+    // has a larger index than its children.
+    size_t L = leaves.size(), nextLeaf = 0, nextMerged = 0, merged = 0;
+    std::vector<uint64_t> weight(2 * L - 1);
+    std::vector<size_t> parent(2 * L - 1);
+    for (size_t i = 0; i < L; ++i) weight[i] = counts[leaves[i]];
+    auto lightest = [&]() {
+        if (nextLeaf < L && (nextMerged == merged || weight[nextLeaf] <= weight[L + nextMerged])) return nextLeaf++;
+        return L + nextMerged++;
+    };
+    auto label = [&](size_t node) { return node < L ? leaves[node] : (int)(256 + node - L); };
+    for (; merged < L - 1; ++merged) {
+        size_t a = lightest(), b = lightest(), node = L + merged;
+        weight[node] = weight[a] + weight[b];
+        parent[a] = parent[b] = node;
+        if (merges) merges->push_back({label(a), label(b), label(node), weight[node]});
+    }
+    std::vector<uint8_t> depth(2 * L - 1);
+    for (size_t node = 2 * L - 2; node-- > 0;) depth[node] = depth[parent[node]] + 1;
+    for (size_t i = 0; i < L; ++i) lengths[leaves[i]] = depth[i];
+    return lengths;
+}
+
+// Caps every length at HUFFMAN_MAX_BITS, then restores the Kraft inequality
+// (sum of 2^-length <= 1, which a prefix code needs) by lengthening the
+// least frequent codes that are still short enough, and finally spends any
+// slack shortening the most frequent ones. Returns whether a length changed.
+inline bool limitHuffmanLengths(CodeLengths& lengths, const ByteHistogram& counts) {
+    const uint64_t full = 1ULL << HUFFMAN_MAX_BITS;
+    uint64_t kraft = 0;
+    bool changed = false;
+    std::vector<int> used;
+    for (int s = 0; s < 256; ++s) {
+        if (!lengths[s]) continue;
+        used.push_back(s);
+        if (lengths[s] > HUFFMAN_MAX_BITS) {
+            lengths[s] = HUFFMAN_MAX_BITS;
+            changed = true;
+        }
+        kraft += full >> lengths[s];
+    }
+    if (!changed) return false;
+    std::sort(used.begin(), used.end(), [&](int a, int b) { return counts[a] != counts[b] ? counts[a] < counts[b] : a < b; });
+    while (kraft > full) {
+        for (int s : used) {
+            if (lengths[s] == HUFFMAN_MAX_BITS) continue;
+            kraft -= full >> (lengths[s] + 1);
+            ++lengths[s];
+            if (kraft <= full) break;
+        }
+    }
+    for (auto it = used.rbegin(); it != used.rend(); ++it) {
+        while (lengths[*it] > 1 && kraft + (full >> lengths[*it]) <= full) {
+            kraft += full >> lengths[*it];
+            --lengths[*it];
+        }
+    }
+    return true;
+}
+
+// Canonical codes, bit-reversed for LSB-first output.
+struct HuffmanCodes {
+    std::array<uint16_t, 256> bits{};
+    CodeLengths lengths{};
+};
+
+inline HuffmanCodes canonicalCodes(const CodeLengths& lengths) {
+    HuffmanCodes codes;
+    codes.lengths = lengths;
+    int perLength[HUFFMAN_MAX_BITS + 1] = {};
+    for (int s = 0; s < 256; ++s) ++perLength[lengths[s]];
+    perLength[0] = 0;
+    uint32_t next[HUFFMAN_MAX_BITS + 2] = {};
+    for (int len = 1; len <= HUFFMAN_MAX_BITS; ++len) next[len] = (next[len - 1] + perLength[len - 1]) << 1;
+    for (int s = 0; s < 256; ++s) {
+        int len = lengths[s];
+        if (!len) continue;
+        uint32_t code = next[len]++, reversed = 0;
+        for (int b = 0; b < len; ++b) reversed |= ((code >> b) & 1) << (len - 1 - b);
+        codes.bits[s] = (uint16_t)reversed;
+    }
+    return codes;
+}
+
+// The bits of one lookup: symbols[0..count) take `bits` bits in all, the
+// first of them firstBits. count == 0 marks bits no code starts with.
+struct HuffmanEntry {
+    uint8_t symbols[HUFFMAN_MAX_SYMBOLS];
+    uint8_t count, bits, firstBits, unused;
+};
+
+inline std::vector<HuffmanEntry> huffmanDecodeTable(const HuffmanCodes& codes) {
+    // One symbol per entry first, then as many more as fit in the window.
+    std::vector<HuffmanEntry> single(HUFFMAN_TABLE_SIZE), table(HUFFMAN_TABLE_SIZE);
+    for (int s = 0; s < 256; ++s) {
+        int len = codes.lengths[s];
+        if (!len) continue;
+        for (int fill = 0; fill < (HUFFMAN_TABLE_SIZE >> len); ++fill) {
+            HuffmanEntry& e = single[codes.bits[s] | (fill << len)];
+            e.symbols[0] = (uint8_t)s;
+            e.count = 1;
+            e.bits = e.firstBits = (uint8_t)len;
+        }
+    }
+    for (int index = 0; index < HUFFMAN_TABLE_SIZE; ++index) {
+        HuffmanEntry& e = table[index];
+        e = single[index];
+        while (e.count && e.count < HUFFMAN_MAX_SYMBOLS) {
+            const HuffmanEntry& next = single[index >> e.bits];
+            if (!next.count || e.bits + next.bits > HUFFMAN_MAX_BITS) break;
+            e.symbols[e.count++] = next.symbols[0];
+            e.bits += next.bits;
+        }
+    }
+    return table;
+}
+
+// Appends codes to a byte buffer through a 64-bit bit buffer, 32 bits at a
+// time; codes are at most HUFFMAN_MAX_BITS long, so the buffer never fills.
+struct HuffmanBitWriter {
+    std::vector<uint8_t>& out;
+    uint64_t bits = 0;
+    int count = 0;
+
+    void put(uint32_t code, int length) {
+        bits |= (uint64_t)code << count;
+        count += length;
+        if (count >= 32) {
+            uint8_t word[4] = {(uint8_t)bits, (uint8_t)(bits >> 8), (uint8_t)(bits >> 16), (uint8_t)(bits >> 24)};
+            out.insert(out.end(), word, word + 4);
+            bits >>= 32;
+            count -= 32;
+        }
+    }
+    void flush() {
+        for (; count > 0; count -= 8, bits >>= 8) out.push_back((uint8_t)bits);
+        count = 0;
+        bits = 0;
+    }
+};
+
+struct FileCloser {
+    void operator()(FILE* f) const { if (f) fclose(f); }
+};
+using FilePtr = std::unique_ptr<FILE, FileCloser>;
+
+inline std::string huffmanHistogram(const std::string& path, ByteHistogram& counts, uint64_t& size) {
+    FilePtr in(fopen(path.c_str(), "rb"));
+    if (!in) return "Cannot open " + path;
+    counts.fill(0);
+    size = 0;
+    std::vector<uint8_t> buf(HUFFMAN_CHUNK);
+    // Four histograms side by side, so runs of one byte do not serialize on
+    // a single counter.
+    std::vector<uint64_t> lanes(4 * 256);
+    for (size_t got; (got = fread(buf.data(), 1, buf.size(), in.get())) > 0;) {
+        size_t i = 0;
+        for (; i + 4 <= got; i += 4) {
+            ++lanes[buf[i]];
+            ++lanes[256 + buf[i + 1]];
+            ++lanes[512 + buf[i + 2]];
+            ++lanes[768 + buf[i + 3]];
+        }
+        for (; i < got; ++i) ++lanes[buf[i]];
+        size += got;
+    }
+    for (int s = 0; s < 256; ++s) counts[s] = lanes[s] + lanes[256 + s] + lanes[512 + s] + lanes[768 + s];
+    return ferror(in.get()) ? "Cannot read " + path : "";
+}
+
+// Encodes inPath into outPath with the given code; the input is read a chunk
+// at a time, so any size streams through in constant memory.
+inline std::string huffmanEncodeFile(const std::string& inPath, const std::string& outPath, const HuffmanCodes& codes,
+                                     uint64_t size, uint64_t& written) {
+    FilePtr in(fopen(inPath.c_str(), "rb"));
+    if (!in) return "Cannot open " + inPath;
+    FilePtr out(fopen(outPath.c_str(), "wb"));
+    if (!out) return "Cannot write " + outPath;
+    std::vector<uint8_t> header(HUFFMAN_MAGIC, HUFFMAN_MAGIC + 4);
+    for (int b = 0; b < 8; ++b) header.push_back((uint8_t)(size >> (8 * b)));
+    header.insert(header.end(), codes.lengths.begin(), codes.lengths.end());
+    bool ok = fwrite(header.data(), 1, header.size(), out.get()) == header.size();
+    written = header.size();
+
+    std::vector<uint8_t> buf(HUFFMAN_CHUNK), encoded;
+    encoded.reserve(HUFFMAN_CHUNK * HUFFMAN_MAX_BITS / 8 + 8);
+    HuffmanBitWriter writer{encoded};
+    for (size_t got; ok && (got = fread(buf.data(), 1, buf.size(), in.get())) > 0;) {
+        for (size_t i = 0; i < got; ++i) writer.put(codes.bits[buf[i]], codes.lengths[buf[i]]);
+        ok = fwrite(encoded.data(), 1, encoded.size(), out.get()) == encoded.size();
+        written += encoded.size();
+        encoded.clear();
+    }
+    writer.flush();
+    ok = ok && fwrite(encoded.data(), 1, encoded.size(), out.get()) == encoded.size();
+    written += encoded.size();
+    return ok && !ferror(in.get()) ? "" : "Cannot write " + outPath;
+}
+
+inline std::string huffmanDecodeFile(const std::string& inPath, const std::string& outPath, uint64_t& size) {
+    FilePtr in(fopen(inPath.c_str(), "rb"));
+    if (!in) return "Cannot open " + inPath;
+    uint8_t header[4 + 8 + 256];
+    if (fread(header, 1, sizeof header, in.get()) != sizeof header || memcmp(header, HUFFMAN_MAGIC, 4) != 0)
+        return inPath + " is not a Huffman file";
+    size = 0;
+    for (int b = 0; b < 8; ++b) size |= (uint64_t)header[4 + b] << (8 * b);
+    CodeLengths lengths;
+    memcpy(lengths.data(), header + 12, 256);
+    uint64_t kraft = 0;
+    int used = 0;
+    for (uint8_t len : lengths) {
+        if (len > HUFFMAN_MAX_BITS) return inPath + " has a code longer than " + std::to_string(HUFFMAN_MAX_BITS) + " bits";
+        if (len) kraft += (uint64_t)HUFFMAN_TABLE_SIZE >> len, ++used;
+    }
+    if (kraft > (uint64_t)HUFFMAN_TABLE_SIZE || (size && !used)) return inPath + " has an invalid code";
+    std::vector<HuffmanEntry> table = huffmanDecodeTable(canonicalCodes(lengths));
+    FilePtr out(fopen(outPath.c_str(), "wb"));
+    if (!out) return "Cannot write " + outPath;
+
+    // The input window keeps 8 spare bytes so a refill can always load a
+    // whole word; past the end of the file they read as zeros.
+    std::vector<uint8_t> input(HUFFMAN_CHUNK + 8), output(HUFFMAN_CHUNK + HUFFMAN_MAX_SYMBOLS);
+    size_t have = 0, at = 0, produced = 0;
+    bool eof = false;
+    uint64_t bits = 0, done = 0;
+    int count = 0;
+    while (done < size) {
+        if (!eof && have - at < 8) {
+            memmove(input.data(), input.data() + at, have - at);
+            have -= at;
+            at = 0;
+            size_t got = fread(input.data() + have, 1, HUFFMAN_CHUNK - have, in.get());
+            have += got;
+            eof = got == 0;
+            std::fill(input.begin() + have, input.end(), 0);
+        }
+        if (eof && at >= have && count == 0) return inPath + " is truncated";
+
+        // Away from the ends of the input, the output buffer and the data,
+        // none of the bounds below can be hit: decode without checking them.
+        while (at + 16 <= have && size - done >= 4 * HUFFMAN_MAX_SYMBOLS && produced + 4 * HUFFMAN_MAX_SYMBOLS <= HUFFMAN_CHUNK) {
+            uint64_t word;
+            memcpy(&word, input.data() + at, 8);
+            bits |= word << count;
+            at += (63 - count) >> 3;
+            count |= 56;
+            for (int lookup = 0; lookup < 4; ++lookup) {
+                const HuffmanEntry& e = table[bits & (HUFFMAN_TABLE_SIZE - 1)];
+                if (e.count == 0) return inPath + " is corrupt";
+                memcpy(output.data() + produced, e.symbols, HUFFMAN_MAX_SYMBOLS);
+                produced += e.count;
+                done += e.count;
+                bits >>= e.bits;
+                count -= e.bits;
+            }
+        }
+
+        // Branchless refill to 56 or more bits.
+        uint64_t word;
+        memcpy(&word, input.data() + at, 8);
+        bits |= word << count;
+        size_t take = (63 - count) >> 3;
+        at += take;
+        count += (int)take * 8;
+        if (at > have) count -= (int)(at - have) * 8, at = have;
+
+        // Four lookups per refill: each uses at most HUFFMAN_MAX_BITS bits.
+        for (int lookup = 0; lookup < 4 && done < size; ++lookup) {
+            const HuffmanEntry& e = table[bits & (HUFFMAN_TABLE_SIZE - 1)];
+            int n = e.count, used = e.bits;
+            if (n == 0) return inPath + " is corrupt";
+            if (n > (int)(size - done)) n = 1, used = e.firstBits;
+            if (used > count) return inPath + " is truncated";
+            memcpy(output.data() + produced, e.symbols, HUFFMAN_MAX_SYMBOLS);
+            produced += n;
+            done += n;
+            bits >>= used;
+            count -= used;
+            if (produced >= HUFFMAN_CHUNK) {
+                if (fwrite(output.data(), 1, produced, out.get()) != produced) return "Cannot write " + outPath;
+                produced = 0;
+            }
+        }
+    }
+    if (fwrite(output.data(), 1, produced, out.get()) != produced) return "Cannot write " + outPath;
+    return "";
+}
@@ -1,13 +1,37 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <mutex>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "trace.h"
+#include "stats.h"
 using namespace std;
+using namespace std::chrono;
+
+const size_t STREAM_CHUNK = 64u << 20;       // bytes per read / per thread block
+const int DFA_LIMIT = 1 << 22;               // max (pattern length + 1) * 256 table cells
+const size_t MATCH_BUFFER = 1u << 20;        // bytes of formatted matches a thread holds before writing
+
+bool traceOn = true;
 
 void logStep(const string& text,
              const string& pattern,
              int l,
              int r,
              const string& message) {
+    if (!traceOn || !traceKeep(traceImportant(message))) return;
     cout << "{";
     cout << "\"type\":\"KMP\", ";
     if (l >= 0)     cout << "\"l\":"       << l       << ", ";
@@ -95,10 +119,215 @@ void KMPSearch(const string& text, const string& pattern) {
     logStep(text, pattern, /*l=*/-1, /*r=*/-1, "Pattern not found");
 }
 
+// KMP as a byte automaton: delta[j * 256 + c] is the next matched length
+// after reading c in state j, precomputed from the LPS array so the scan is one
+// table lookup per byte. Very long patterns keep the LPS fallback loop.
+struct KMPAutomaton {
+    string pattern;
+    int m;
+    vector<int> lps, delta;
+
+    explicit KMPAutomaton(const string& p) : pattern(p), m(p.size()), lps(p.size()) {
+        bool saved = traceOn;
+        traceOn = false;
+        lpsarray(pattern, lps);
+        traceOn = saved;
+        if ((long long)(m + 1) * 256 > DFA_LIMIT) return;
+        delta.assign((size_t)(m + 1) * 256, 0);
+        for (int j = 0; j <= m; ++j) {
+            for (int c = 0; c < 256; ++c) {
+                if (j < m && (unsigned char)pattern[j] == c) delta[j * 256 + c] = j + 1;
+                else if (j > 0) delta[j * 256 + c] = delta[lps[j - 1] * 256 + c];
+            }
+        }
+    }
+
+    // Feeds bytes that start at absolute offset `base`, carrying the matched
+    // length j across calls; reports the start offset of every match.
+    template <typename OnMatch>
+    int feed(const char* data, size_t len, long long base, int j, OnMatch onMatch) const {
+        if (!delta.empty()) {
+            for (size_t i = 0; i < len; ++i) {
+                j = delta[j * 256 + (unsigned char)data[i]];
+                if (j == m) onMatch(base + (long long)i - m + 1);
+            }
+            return j;
+        }
+        for (size_t i = 0; i < len; ++i) {
+            if (j == m) j = lps[j - 1];
+            while (j > 0 && pattern[j] != data[i]) j = lps[j - 1];
+            if (pattern[j] == data[i]) ++j;
+            if (j == m) onMatch(base + (long long)i - m + 1);
+        }
+        return j;
+    }
+};
+
+// Hands the turn to write to stdout from block to block in file order.
+class BlockTurns {
+    mutex lock;
+    condition_variable changed;
+    size_t turn = 0;
+
+public:
+    void wait(size_t block) {
+        unique_lock<mutex> hold(lock);
+        changed.wait(hold, [&] { return turn == block; });
+    }
+    void pass(size_t block) {
+        {
+            lock_guard<mutex> hold(lock);
+            turn = block + 1;
+        }
+        changed.notify_all();
+    }
+};
+
+// Formats one block's matches into a fixed buffer and writes it to cout when
+// it fills, so memory does not grow with the number of matches. With turns,
+// the first write waits until every earlier block has been written.
+class MatchWriter {
+    vector<char> buf = vector<char>(MATCH_BUFFER);
+    size_t used = 0;
+    BlockTurns* turns;
+    size_t block = 0;
+    bool myTurn = false;
+
+    void write() {
+        if (turns && !myTurn) {
+            turns->wait(block);
+            myTurn = true;
+        }
+        cout.write(buf.data(), used);
+        used = 0;
+    }
+
+public:
+    long long count = 0;
+
+    explicit MatchWriter(BlockTurns* turns = nullptr) : turns(turns) {}
+
+    void start(size_t b) {
+        block = b;
+        myTurn = false;
+    }
+
+    void add(long long at) {
+        static const char head[] = "{\"type\":\"KMP\", \"match\":";
+        if (buf.size() - used < sizeof head + 24) write();
+        char* out = copy(head, head + sizeof head - 1, buf.data() + used);
+        out = to_chars(out, buf.data() + buf.size(), at).ptr;
+        *out++ = '}';
+        *out++ = '\n';
+        used = out - buf.data();
+        ++count;
+    }
+
+    // Writes what is left of the block and gives the turn to the next one.
+    void finish() {
+        write();
+        cout.flush();
+        if (turns) turns->pass(block);
+    }
+};
+
+// Sequential streaming: the automaton state survives chunk boundaries, so a
+// match split across two reads is still found.
+long long streamRead(FILE* in, const KMPAutomaton& kmp, long long& bytes) {
+    vector<char> buf(STREAM_CHUNK);
+    MatchWriter writer;
+    int j = 0;
+    for (size_t got; (got = fread(buf.data(), 1, buf.size(), in)) > 0; bytes += got) {
+        j = kmp.feed(buf.data(), got, bytes, j, [&](long long at) { writer.add(at); });
+        writer.finish();
+    }
+    return writer.count;
+}
+
+#ifndef _WIN32
+// Parallel scan of a mapped file. Threads take blocks in file order; each
+// restarts the automaton m - 1 bytes before its block and keeps only matches
+// that end inside the block, so every match is reported once. A block's
+// matches are written once the blocks before it are, through the thread's
+// MatchWriter, so memory stays at one buffer per thread however many match.
+long long streamMapped(const char* data, size_t size, const KMPAutomaton& kmp, int threads) {
+    size_t blocks = (size + STREAM_CHUNK - 1) / STREAM_CHUNK;
+    BlockTurns turns;
+    atomic<size_t> next{0};
+    atomic<long long> total{0};
+    auto scan = [&]() {
+        MatchWriter writer(&turns);
+        for (size_t b; (b = next++) < blocks;) {
+            writer.start(b);
+            size_t begin = b * STREAM_CHUNK, end = min(size, begin + STREAM_CHUNK);
+            size_t from = begin >= (size_t)kmp.m - 1 ? begin - (kmp.m - 1) : 0;
+            kmp.feed(data + from, end - from, from, 0, [&](long long at) {
+                if (at + kmp.m - 1 >= (long long)begin) writer.add(at);
+            });
+            writer.finish();
+        }
+        total += writer.count;
+    };
+    vector<thread> pool;
+    for (int t = 1; t < min<long long>(threads, blocks); ++t) pool.emplace_back(scan);
+    scan();
+    for (auto& t : pool) t.join();
+    return total;
+}
+#endif
+
+int streamSearch(const string& path, const string& pattern, int threads) {
+    traceOn = false;
+    if (pattern.empty()) {
+        cout << "{\"type\":\"error\",\"message\":\"Empty pattern\"}" << endl;
+        return 1;
+    }
+    KMPAutomaton kmp(pattern);
+    auto start = steady_clock::now();
+    long long bytes = 0, matches = -1;
+
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+            matches = streamMapped((const char*)mapped, st.st_size, kmp, threads);
+            bytes = st.st_size;
+            munmap(mapped, st.st_size);
+        }
+    }
+    if (fd >= 0) close(fd);
+#endif
+    if (matches < 0) {
+        FILE* in = path == "-" ? stdin : fopen(path.c_str(), "rb");
+        if (!in) {
+            cout << "{\"type\":\"error\",\"message\":\"Cannot open " << path << "\"}" << endl;
+            return 1;
+        }
+        matches = streamRead(in, kmp, bytes);
+        if (in != stdin) fclose(in);
+    }
+
+    double seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+    cout << "{\"type\":\"KMP\", \"action\":\"final\", \"matches\":" << matches
+         << ", \"bytes\":" << bytes
+         << ", \"MBps\":" << (seconds > 0 ? bytes / seconds / 1e6 : 0) << "}" << endl;
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
+    StatsReport report(argc > 3 && string(argv[1]) == "file" ? "kmp-file" : "kmp");
     string text    = "auntymomos";
     string pattern = "momo";
 
+    if (argc > 3 && string(argv[1]) == "file") {
+        // file <path or -> <pattern> [threads]
+        int threads = argc > 4 ? stoi(argv[4]) : max(1u, thread::hardware_concurrency());
+        return streamSearch(argv[2], argv[3], max(1, threads));
+    }
+
     if (argc > 1) text    = argv[1];
     if (argc > 2) pattern = argv[2];
 
@@ -1,10 +1,21 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <queue>
+#include <chrono>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include "trace.h"
+#include "stats.h"
 
 using namespace std;
+using namespace std::chrono;
+
+const long long DP_CELL_LIMIT = 1LL << 26;    // beyond this the dp table is not allocated
 
 void printStep(int i, int w, const string& decision, int currentValue, const vector<vector<int>>& dp) {
+    if (!traceKeep()) return;
     cout << "{";
     cout << "\"step\": " << i << ", ";
     cout << "\"weight\": " << w << ", ";
@@ -21,17 +32,29 @@ void printStep(int i, int w, const string& decision, int currentValue, const vec
 
 int knapsack(int W, const vector<int>& weights, const vector<int>& values) {
     int n = weights.size();
-    vector<vector<int>> dp(n, vector<int>(W , 0));
+    vector<vector<int>> dp(n + 1, vector<int>(W + 1, 0));
 
     for (int i = 1; i <= n; ++i) {
         for (int w = 0; w <= W; ++w) {
+            // Keyframe for the seekable trace (trace.h): the finished rows.
+            if (traceKeyframeDue()) {
+                string state = "{\"rows\":[";
+                for (int r = 0; r < i; ++r) {
+                    state += r ? ",[" : "[";
+                    for (int j = 0; j <= W; ++j) state += (j ? "," : "") + to_string(dp[r][j]);
+                    state += "]";
+                }
+                traceKeyframe(state + "]}");
+            }
             if (weights[i - 1] <= w) {
                 int include = values[i - 1] + dp[i - 1][w - weights[i - 1]];
                 int exclude = dp[i - 1][w];
                 dp[i][w] = max(include, exclude);
+                statAdd(Stat::DpCells);
                 printStep(i, w, (include > exclude ? "include" : "exclude"), dp[i][w], dp);
             } else {
                 dp[i][w] = dp[i - 1][w];
+                statAdd(Stat::DpCells);
                 printStep(i, w, "exclude", dp[i][w], dp);
             }
         }
@@ -41,32 +64,249 @@ int knapsack(int W, const vector<int>& weights, const vector<int>& values) {
     return dp[n][W];
 }
 
-vector<int> parseArgs(int argc, char* argv[], int start, int count) {
-    vector<int> result;
+struct Item {
+    long long weight, value;
+    int index;
+};
+
+struct BnBBudget {
+    long long maxNodes = 5000000;
+    long long timeMs = 10000;
+    size_t maxQueue = 1 << 20;
+};
+
+struct BnBNode {
+    double bound;
+    long long value, weight;
+    int level;
+    int decision;               // index into the decision arena, -1 for the root
+};
+
+struct BnBCompare {
+    bool operator()(const BnBNode& a, const BnBNode& b) const { return a.bound < b.bound; }
+};
+
+// Sorted by value density with prefix sums, so the fractional (greedy)
+// relaxation of any suffix is a binary search for its break item.
+struct DensityOrder {
+    vector<Item> items;
+    vector<long long> prefixW, prefixV;
+
+    explicit DensityOrder(vector<Item> sorted) : items(move(sorted)) {
+        sort(items.begin(), items.end(), [](const Item& a, const Item& b) {
+            return (__int128)a.value * b.weight > (__int128)b.value * a.weight;
+        });
+        prefixW.assign(items.size() + 1, 0);
+        prefixV.assign(items.size() + 1, 0);
+        for (size_t i = 0; i < items.size(); ++i) {
+            prefixW[i + 1] = prefixW[i] + items[i].weight;
+            prefixV[i + 1] = prefixV[i] + items[i].value;
+        }
+    }
+
+    double bound(int from, long long capacity, long long value) const {
+        long long limit = prefixW[from] + capacity;
+        int b = upper_bound(prefixW.begin() + from, prefixW.end(), limit) - prefixW.begin() - 1;
+        double result = value + (prefixV[b] - prefixV[from]);
+        if (b < (int)items.size())
+            result += (double)(limit - prefixW[b]) * items[b].value / items[b].weight;
+        return result;
+    }
+};
+
+void logBnB(const string& action, long long nodes, long long best, double bound, const string& message) {
+    if (!traceKeep(action != "bnb-progress")) return;
+    cout << "{\"action\": \"" << action << "\", "
+         << "\"nodes\": " << nodes << ", "
+         << "\"best\": " << best << ", "
+         << "\"bound\": " << (long long)floor(bound) << ", "
+         << "\"message\": \"" << message << "\"}" << endl;
+}
+
+// Best-first branch and bound for capacities the dp table cannot hold.
+// Items are ordered by density and every node is bounded by the fractional
+// relaxation. Before searching, items whose flipped greedy decision provably
+// cannot beat the greedy solution are fixed (core reduction around the break
+// item). The queue is capped at budget.maxQueue by discarding the weakest half;
+// the result is reported optimal only when nothing discarded could still win.
+long long knapsackBranchAndBound(long long W, const vector<long long>& weights, const vector<long long>& values, const BnBBudget& budget) {
+    auto start = steady_clock::now();
+    int n = weights.size();
+
+    vector<Item> all;
+    for (int i = 0; i < n; ++i)
+        if (weights[i] <= W && values[i] > 0) all.push_back({weights[i], values[i], i});
+    DensityOrder full(all);
+    const vector<Item>& items = full.items;
+    int m = items.size();
+
+    // Greedy solution: the LP prefix up to the break item, then anything else that fits.
+    int breakItem = upper_bound(full.prefixW.begin(), full.prefixW.end(), W) - full.prefixW.begin() - 1;
+    vector<char> greedyTake(m, 0);
+    long long greedyValue = 0, room = W;
+    for (int i = 0; i < m; ++i) {
+        if (items[i].weight <= room) {
+            greedyTake[i] = 1;
+            room -= items[i].weight;
+            greedyValue += items[i].value;
+        }
+    }
+    double rootBound = full.bound(0, W, 0);
+    logBnB("bnb-start", 0, greedyValue, rootBound, "Greedy solution and fractional bound");
+
+    // Core reduction: flipping x_i away from its LP value costs at least
+    // |v_i - r * w_i| where r is the break item's density.
+    vector<Item> core;
+    long long fixedValue = 0, fixedWeight = 0;
+    vector<int> fixedTaken;
+    double r = breakItem < m ? (double)items[breakItem].value / items[breakItem].weight : 0.0;
+    for (int i = 0; i < m; ++i) {
+        bool inLP = i < breakItem;
+        double flipped = rootBound - fabs(items[i].value - r * items[i].weight);
+        if (i != breakItem && floor(flipped + 1e-9) <= greedyValue) {
+            if (inLP) {
+                fixedValue += items[i].value;
+                fixedWeight += items[i].weight;
+                fixedTaken.push_back(items[i].index);
+            }
+        } else {
+            core.push_back(items[i]);
+        }
+    }
+    logBnB("bnb-reduce", 0, greedyValue, rootBound,
+           "Fixed " + to_string(m - (int)core.size()) + " items, core has " + to_string(core.size()));
+
+    DensityOrder order(core);
+    long long capacity = W - fixedWeight;
+    long long best = greedyValue;
+    vector<int> bestTaken;
+    for (int i = 0; i < m; ++i)
+        if (greedyTake[i]) bestTaken.push_back(items[i].index);
+
+    vector<pair<int, int>> decisions;   // (parent decision, core position taken)
+    int bestDecision = -2;              // -2: the greedy solution is still the incumbent
+    double droppedBound = 0;
+    long long nodes = 0;
+    bool exhausted = true;
+
+    priority_queue<BnBNode, vector<BnBNode>, BnBCompare> pq;
+    pq.push({order.bound(0, capacity, 0) + fixedValue, fixedValue, 0, 0, -1});
+
+    while (!pq.empty()) {
+        BnBNode node = pq.top();
+        pq.pop();
+        if (floor(node.bound + 1e-9) <= best) break;    // best-first: nothing left can win
+
+        if (++nodes > budget.maxNodes ||
+            ((nodes & 1023) == 0 && duration_cast<milliseconds>(steady_clock::now() - start).count() > budget.timeMs)) {
+            exhausted = false;
+            break;
+        }
+        if ((nodes & ((1 << 16) - 1)) == 0)
+            logBnB("bnb-progress", nodes, best, node.bound, "Exploring");
+
+        if (node.level == (int)order.items.size()) continue;
+        const Item& it = order.items[node.level];
+
+        if (node.weight + it.weight <= capacity) {
+            decisions.push_back({node.decision, node.level});
+            BnBNode take{0, node.value + it.value, node.weight + it.weight, node.level + 1, (int)decisions.size() - 1};
+            take.bound = order.bound(take.level, capacity - take.weight, take.value);
+            if (take.value > best) {
+                best = take.value;
+                bestDecision = take.decision;
+                logBnB("bnb-improve", nodes, best, node.bound, "New incumbent");
+            }
+            if (floor(take.bound + 1e-9) > best) pq.push(take);
+        }
+
+        BnBNode skip{0, node.value, node.weight, node.level + 1, node.decision};
+        skip.bound = order.bound(skip.level, capacity - skip.weight, skip.value);
+        if (floor(skip.bound + 1e-9) > best) pq.push(skip);
+
+        if (pq.size() > budget.maxQueue) {
+            vector<BnBNode> kept;
+            kept.reserve(pq.size());
+            while (!pq.empty()) {
+                kept.push_back(pq.top());
+                pq.pop();
+            }
+            size_t keep = budget.maxQueue / 2;
+            for (size_t i = keep; i < kept.size(); ++i) droppedBound = max(droppedBound, kept[i].bound);
+            kept.resize(keep);
+            pq = priority_queue<BnBNode, vector<BnBNode>, BnBCompare>(BnBCompare(), move(kept));
+        }
+    }
+
+    if (bestDecision != -2) {
+        bestTaken = fixedTaken;
+        for (int d = bestDecision; d >= 0; d = decisions[d].first)
+            bestTaken.push_back(order.items[decisions[d].second].index);
+    }
+    sort(bestTaken.begin(), bestTaken.end());
+
+    statAdd(Stat::Nodes, nodes);
+    bool optimal = exhausted && floor(droppedBound + 1e-9) <= best;
+    long long elapsed = duration_cast<milliseconds>(steady_clock::now() - start).count();
+    cout << "{\"action\": \"bnb-final\", \"nodes\": " << nodes
+         << ", \"timeMs\": " << elapsed
+         << ", \"cacheable\": false"      // timed, and bounded by a wall-clock budget
+         << ", \"optimal\": " << (optimal ? "true" : "false")
+         << ", \"items\": [";
+    for (size_t i = 0; i < bestTaken.size(); ++i)
+        cout << bestTaken[i] << (i + 1 < bestTaken.size() ? ", " : "");
+    cout << "]}" << endl;
+    cout << "{\"finalValue\": " << best << "}" << endl;
+    return best;
+}
+
+vector<long long> parseArgs(int argc, char* argv[], int start, int count) {
+    vector<long long> result;
     for (int i = start; i < start + count && i < argc; ++i) {
-        result.push_back(stoi(argv[i]));
+        result.push_back(stoll(argv[i]));
     }
     return result;
 }
 
 int main(int argc, char* argv[]) {
-    int W = 10;
-    vector<int> weights = {2, 3, 4, 5};
-    vector<int> values = {3, 4, 5, 6};
-
-    if (argc > 3) {
-        W = stoi(argv[1]);
-        int itemCount = stoi(argv[2]);
-        if (argc >= 3 + 2 * itemCount) {
-            weights = parseArgs(argc, argv, 3, itemCount);
-            values = parseArgs(argc, argv, 3 + itemCount, itemCount);
+    bool branchAndBound = argc > 1 && string(argv[1]) == "bnb";
+    int first = branchAndBound ? 2 : 1;
+
+    long long W = 10;
+    vector<long long> weights = {2, 3, 4, 5};
+    vector<long long> values = {3, 4, 5, 6};
+    BnBBudget budget;
+
+    if (argc > first + 2) {
+        W = stoll(argv[first]);
+        int itemCount = stoi(argv[first + 1]);
+        int extra = first + 2 + 2 * itemCount;
+        if (argc >= extra) {
+            weights = parseArgs(argc, argv, first + 2, itemCount);
+            values = parseArgs(argc, argv, first + 2 + itemCount, itemCount);
+            if (argc > extra) budget.maxNodes = stoll(argv[extra]);
+            if (argc > extra + 1) budget.timeMs = stoll(argv[extra + 1]);
         } else {
             cerr << " Not enough arguments for weights and values." << endl;
             return 1;
         }
     }
+    if ((long long)(weights.size() + 1) * (W + 1) > DP_CELL_LIMIT) branchAndBound = true;
+    // The dp table holds ints: weights, values and any total of values must fit.
+    long long valueTotal = 0;
+    for (size_t i = 0; i < weights.size(); ++i) {
+        if (weights[i] < 0 || weights[i] > INT_MAX || values[i] < 0 || values[i] > INT_MAX) branchAndBound = true;
+        else valueTotal += values[i];
+    }
+    if (valueTotal > INT_MAX) branchAndBound = true;
+
+    StatsReport report(branchAndBound ? "knapsack-bnb" : "knapsack");
     cout << "{\"action\": \"start\", \"maxWeight\": " << W << ", \"items\": " << weights.size() << "}" << endl;
-    knapsack(W, weights, values);
+    if (branchAndBound) {
+        knapsackBranchAndBound(W, weights, values, budget);
+    } else {
+        knapsack(W, vector<int>(weights.begin(), weights.end()), vector<int>(values.begin(), values.end()));
+    }
     cout << "{\"action\": \"end\"}" << endl;
     return 0;
-}
\ No newline at end of file
+}
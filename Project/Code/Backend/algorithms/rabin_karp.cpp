@@ -1,67 +1,183 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <map>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include "trace.h"
+#include "stats.h"
 
 using namespace std;
+using namespace std::chrono;
+
+const uint64_t MOD = (1ULL << 61) - 1;      // Mersenne prime: spurious hits ~ n / 2^61
+const size_t TRACE_LIMIT = 256;             // longer texts are searched without per-window steps
+const size_t PARALLEL_MIN = 1 << 22;        // below this a single thread is faster
+
+bool traceOn = true;
 
-const int d = 256; // number of characters in the input alphabet
-const int q = 101; // prime number for hashing
 void logStep(const string& text, int l, int r, const string& message, const string& pattern) {
+    if (!traceOn || !traceKeep(traceImportant(message))) return;
     cout << "{";
     cout << "\"type\":\"Rabin-Karp\", ";
     if (l >= 0) cout << "\"l\":" << l << ", ";
     if (r >= 0) cout << "\"r\":" << r << ", ";
-    cout << "\"text\":\"" << text << "\", ";
-    cout << "\"pattern\":\"" << pattern << "\", ";
-    cout << "\"message\":\"" << message << "\"";
+    cout << "\"text\":\"" << jsonEscape(text) << "\", ";
+    cout << "\"pattern\":\"" << jsonEscape(pattern) << "\", ";
+    cout << "\"message\":\"" << jsonEscape(message) << "\"";
     cout << "}" << endl;
 }
 
-void rabinKarpSearch(const string& text, const string& pattern) {
-    int n = text.size();
-    int m = pattern.size();
-    int p = 0; // hash for pattern
-    int t = 0; // hash for text
-    int h = 1;
-
-    // computing the hash function : h = (d^(m-1)) % q
-    for (int i = 0; i < m - 1; i++)
-        h = (h * d) % q;
-
-    // Initial hash values
-    for (int i = 0; i < m; i++) {
-        p = (d * p + pattern[i]) % q;
-        t = (d * t + text[i]) % q;
+uint64_t mulMod(uint64_t a, uint64_t b) {
+    unsigned __int128 p = (unsigned __int128)a * b;
+    uint64_t r = (uint64_t)(p & MOD) + (uint64_t)(p >> 61);
+    return r >= MOD ? r - MOD : r;
+}
+
+uint64_t addMod(uint64_t a, uint64_t b) {
+    uint64_t r = a + b;
+    return r >= MOD ? r - MOD : r;
+}
+
+// Random base per run, so no fixed input can be built to collide.
+uint64_t hashBase() {
+    static uint64_t base = mt19937_64(steady_clock::now().time_since_epoch().count())() % (MOD - 256) + 256;
+    return base;
+}
+
+uint64_t hashOf(const char* s, size_t m) {
+    uint64_t h = 0;
+    for (size_t i = 0; i < m; i++) h = addMod(mulMod(h, hashBase()), (unsigned char)s[i]);
+    return h;
+}
+
+struct Match {
+    size_t index;
+    int pattern;
+};
+
+// All patterns of one length share a rolling window: the window hash is looked
+// up in a hash set of pattern hashes and candidates are confirmed with memcmp.
+// A 64K-bit filter on the low hash bits keeps most windows out of the map.
+struct LengthGroup {
+    size_t m;
+    uint64_t h;                                 // base^(m-1)
+    unordered_map<uint64_t, vector<int>> byHash;
+    vector<uint64_t> filter = vector<uint64_t>(1 << 10, 0);
+
+    void add(uint64_t hash, int id) {
+        byHash[hash].push_back(id);
+        filter[(hash & 0xffff) >> 6] |= 1ULL << (hash & 63);
     }
+    bool mayContain(uint64_t hash) const { return filter[(hash & 0xffff) >> 6] >> (hash & 63) & 1; }
+};
 
-    for (int i = 0; i <= n - m; i++) {
-        logStep(text, i, -1, "Checking substring starting at index " + to_string(i), pattern);
-        if (p == t) {
-            int j;
-            for (j = 0; j < m; j++)
-                if (text[i + j] != pattern[j])
-                    break;
-            if (j == m) {
-                logStep(text, i, -1, "Pattern found at index " + to_string(i), pattern);
-                return;
+// Scans window starts [from, to) for one group; the last window reads m - 1
+// bytes past `to`, which is the overlap between neighbouring chunks.
+void scanRange(const string& text, const vector<string>& patterns, const LengthGroup& g,
+               size_t from, size_t to, vector<Match>& out) {
+    size_t m = g.m;
+    uint64_t t = hashOf(text.data() + from, m);
+    for (size_t i = from; i < to; i++) {
+        if (traceOn) logStep(text, i, -1, "Checking substring starting at index " + to_string(i), patterns[g.byHash.begin()->second[0]]);
+        auto it = g.mayContain(t) ? g.byHash.find(t) : g.byHash.end();
+        if (it != g.byHash.end()) {
+            bool matched = false;
+            for (int id : it->second) {
+                if (memcmp(text.data() + i, patterns[id].data(), m) == 0) {
+                    out.push_back({i, id});
+                    matched = true;
+                    if (traceOn) logStep(text, i, -1, "Pattern found at index " + to_string(i), patterns[id]);
+                }
             }
+            if (!matched && traceOn) logStep(text, i, -1, "Spurious hash hit at index " + to_string(i), patterns[it->second[0]]);
         }
-        if (i < n - m) {
-            t = (d * (t - text[i] * h) + text[i + m]) % q;
-            if (t < 0) t += q;
+        if (i + 1 < to) {
+            uint64_t drop = mulMod((unsigned char)text[i], g.h);
+            t = addMod(mulMod(addMod(t, MOD - drop), hashBase()), (unsigned char)text[i + m]);
         }
     }
+}
+
+vector<Match> rabinKarpSearch(const string& text, const vector<string>& patterns, int threads) {
+    map<size_t, LengthGroup> groups;
+    for (int id = 0; id < (int)patterns.size(); id++) {
+        size_t m = patterns[id].size();
+        if (m == 0 || m > text.size()) continue;       // nothing to slide over
+        LengthGroup& g = groups[m];
+        g.m = m;
+        g.add(hashOf(patterns[id].data(), m), id);
+    }
 
-    logStep(text, -1, -1, "Pattern not found", pattern);
+    vector<Match> matches;
+    for (auto& [m, g] : groups) {
+        // computing h = base^(m-1) mod p
+        g.h = 1;
+        for (size_t i = 0; i + 1 < m; i++) g.h = mulMod(g.h, hashBase());
+
+        size_t windows = text.size() - m + 1;
+        int parts = windows >= PARALLEL_MIN && !traceOn ? threads : 1;
+        vector<vector<Match>> found(parts);
+        vector<thread> pool;
+        for (int p = 0; p < parts; p++) {
+            size_t from = windows * p / parts, to = windows * (p + 1) / parts;
+            if (p + 1 == parts) scanRange(text, patterns, g, from, to, found[p]);
+            else pool.emplace_back(scanRange, cref(text), cref(patterns), cref(g), from, to, ref(found[p]));
+        }
+        for (auto& t : pool) t.join();
+        for (auto& f : found) matches.insert(matches.end(), f.begin(), f.end());
+    }
+    sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) {
+        return a.index != b.index ? a.index < b.index : a.pattern < b.pattern;
+    });
+    return matches;
+}
+
+string readFile(const string& path) {
+    ifstream in(path, ios::binary);
+    stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
 }
 
 int main(int argc, char* argv[]) {
+    StatsReport report("rabin-karp");
     string text  = "pansinghtomar";
-    string pattern = "singh";
+    vector<string> patterns = {"singh"};
+
+    if (argc > 3 && string(argv[1]) == "file") {
+        text = readFile(argv[2]);
+        patterns.assign(argv + 3, argv + argc);
+    } else {
+        if (argc > 1) text = argv[1];
+        if (argc > 2) patterns.assign(argv + 2, argv + argc);
+    }
+    traceOn = text.size() <= TRACE_LIMIT;
+
+    string joined;
+    for (size_t i = 0; i < patterns.size(); i++) joined += (i ? "," : "") + patterns[i];
+    logStep(text, -1, -1, "Starting Rabin-Karp Search", joined);
 
-    if (argc > 1) text    = argv[1];
-    if (argc > 2) pattern = argv[2];
+    auto start = steady_clock::now();
+    int threads = max(1u, thread::hardware_concurrency());
+    vector<Match> matches = rabinKarpSearch(text, patterns, threads);
+    double seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
 
-    logStep(text, -1, -1, "Starting Rabin-Karp Search", pattern);
-    rabinKarpSearch(text, pattern);
+    if (matches.empty()) logStep(text, -1, -1, "Pattern not found", joined);
+    if (traceOn) return 0;
+    for (auto& m : matches)
+        cout << "{\"type\":\"Rabin-Karp\", \"match\":" << m.index << ", \"pattern\":" << m.pattern << "}" << endl;
+    cout << "{\"type\":\"Rabin-Karp\", \"action\":\"final\", "
+         << "\"matches\":" << matches.size() << ", "
+         << "\"threads\":" << (text.size() >= PARALLEL_MIN && !traceOn ? threads : 1) << ", "
+         << "\"searchMBps\":" << (seconds > 0 ? text.size() / seconds / 1e6 : 0) << ", "
+         << "\"cacheable\":false}" << endl;
     return 0;
 }
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <random>
+#include <utility>
+#include <vector>
+#include "sort_engine.h"
+
+// Selection on top of sort_engine.h, with the same (key, less) arguments as
+// sortBy:
+//
+//   nthElementBy(first, nth, last)     *nth is the element a sort would put
+//                                      there; nothing before it is greater,
+//                                      nothing after it less
+//   partialSortBy(first, middle, last) [first, middle) holds the smallest
+//                                      elements in order, the rest is unordered
+//   TopK<T>(k).push(x) ... take()      the k smallest of a stream, in order,
+//                                      keeping at most 2k elements
+//
+// nthElementBy is introselect: median-of-three quickselect, which switches to
+// median-of-medians pivots after 2 log2 n rounds, so it is linear in the worst
+// case. partialSortBy selects with a bounded heap instead when k is small
+// next to n. TopK buffers up to 2k elements, then selects the k smallest and
+// drops the rest; anything not less than the k-th smallest so far is
+// rejected without being stored, so a long stream costs O(n) comparisons.
+//
+// The parallel versions take a thread count and fall back to the sequential
+// ones below PARALLEL_MIN elements. parallelNthElementBy narrows the range
+// with sample-chosen pivot pairs (Floyd-Rivest), counting and scattering
+// each pass on all threads, then finishes with introselect. For small k,
+// parallelPartialSortBy heap-selects each thread's share instead.
+
+const int SELECT_SAMPLE = 1024;
+const std::ptrdiff_t HEAP_SELECT_RATIO = 64;    // partialSortBy keeps a heap when k < n / 64
+
+// ---- introselect ----
+
+template <class It, class Compare>
+void momSelect(It first, It nth, It last, Compare& comp);
+
+// Moves a pivot with at least 3/10 of the range on either side to first: the
+// median of the medians of groups of five.
+template <class It, class Compare>
+void medianOfMediansPivot(It first, It last, Compare& comp) {
+    std::ptrdiff_t n = last - first;
+    It medians = first;
+    for (std::ptrdiff_t g = 0; g < n; g += 5) {
+        It group = first + g, groupEnd = first + std::min(g + 5, n);
+        insertionSort(group, groupEnd, comp);
+        std::iter_swap(medians++, group + (groupEnd - group) / 2);
+    }
+    It mid = first + (medians - first) / 2;
+    momSelect(first, mid, medians, comp);
+    std::iter_swap(first, mid);
+}
+
+template <class It, class Compare>
+void momSelect(It first, It nth, It last, Compare& comp) {
+    while (last - first > INSERTION_MAX) {
+        medianOfMediansPivot(first, last, comp);
+        It cut = partitionAroundFirst(first, last, comp);
+        if (cut == nth) return;
+        if (nth < cut) last = cut;
+        else first = cut + 1;
+    }
+    insertionSort(first, last, comp);
+}
+
+template <class It, class Compare>
+void introselect(It first, It nth, It last, Compare& comp) {
+    if (nth == last) return;
+    int rounds = introsortDepth(last - first);
+    while (last - first > INSERTION_MAX) {
+        if (rounds-- == 0) {
+            momSelect(first, nth, last, comp);
+            return;
+        }
+        It cut = partitionAroundMedian(first, last, comp);
+        if (cut == nth) return;
+        if (nth < cut) last = cut;
+        else first = cut + 1;
+    }
+    insertionSort(first, last, comp);
+}
+
+template <class It, class Key = Identity, class Less = std::less<>>
+void nthElementBy(It first, It nth, It last, Key key = {}, Less less = {}) {
+    auto comp = [&](const auto& a, const auto& b) { return less(key(a), key(b)); };
+    introselect(first, nth, last, comp);
+}
+
+// Keeps the smallest middle - first elements in a max-heap over [first,
+// middle); on random input most later elements lose one comparison to its top.
+template <class It, class Compare>
+void heapSelect(It first, It middle, It last, Compare& comp) {
+    std::make_heap(first, middle, comp);
+    for (It it = middle; it != last; ++it) {
+        if (!comp(*it, *first)) continue;
+        std::pop_heap(first, middle, comp);
+        std::iter_swap(middle - 1, it);
+        std::push_heap(first, middle, comp);
+    }
+}
+
+template <class It, class Key = Identity, class Less = std::less<>>
+void partialSortBy(It first, It middle, It last, Key key = {}, Less less = {}) {
+    if (middle == first) return;
+    if ((middle - first) * HEAP_SELECT_RATIO < last - first) {
+        auto comp = [&](const auto& a, const auto& b) { return less(key(a), key(b)); };
+        heapSelect(first, middle, last, comp);
+    } else {
+        nthElementBy(first, middle - 1, last, key, less);
+    }
+    sortBy(first, middle, key, less);
+}
+
+// ---- streaming top-k ----
+
+template <class T, class Key = Identity, class Less = std::less<>>
+class TopK {
+    size_t k;
+    std::vector<T> items;
+    bool selected = false;      // items[k - 1] is the k-th smallest seen so far
+    Key key;
+    Less less;
+
+    void select() {
+        nthElementBy(items.begin(), items.begin() + (k - 1), items.end(), key, less);
+        items.erase(items.begin() + k, items.end());
+        selected = true;
+    }
+
+public:
+    explicit TopK(size_t k, Key key = {}, Less less = {}) : k(k), key(key), less(less) {}
+
+    void push(const T& x) {
+        if (k == 0 || (selected && !less(key(x), key(items[k - 1])))) return;
+        items.push_back(x);
+        if (items.size() == 2 * k) select();
+    }
+
+    // Adds the elements kept by another TopK over the same k.
+    void merge(TopK&& other) {
+        for (T& x : other.items) push(std::move(x));
+        other.items.clear();
+    }
+
+    // The k smallest elements pushed (fewer if fewer were), in order.
+    std::vector<T> take() {
+        if (items.size() > k) select();
+        sortBy(items.begin(), items.end(), key, less);
+        selected = false;
+        return std::move(items);
+    }
+};
+
+// ---- parallel ----
+
+// One Floyd-Rivest pass over [first, last): picks two pivots from a sample
+// that bracket nth's rank, moves the elements below, between and above them
+// into three consecutive blocks (on all threads, through buffer) and returns
+// the bounds of the block holding nth.
+template <class It, class Compare, class Buffer>
+std::pair<It, It> parallelNarrow(It first, It nth, It last, Compare& comp, int threads, Buffer& buffer,
+                                 std::minstd_rand& random) {
+    using T = typename std::iterator_traits<It>::value_type;
+    std::ptrdiff_t n = last - first;
+    std::vector<T> sample;
+    sample.reserve(SELECT_SAMPLE);
+    for (int i = 0; i < SELECT_SAMPLE; ++i) sample.push_back(first[random() % n]);
+    introsort(sample.begin(), sample.end(), comp);
+    std::ptrdiff_t rank = (nth - first) * SELECT_SAMPLE / n, gap = 2 * (std::ptrdiff_t)std::sqrt(SELECT_SAMPLE);
+    const T& low = sample[std::max<std::ptrdiff_t>(rank - gap, 0)];
+    const T& high = sample[std::min<std::ptrdiff_t>(rank + gap, SELECT_SAMPLE - 1)];
+    auto block = [&](const T& x) { return comp(x, low) ? 0 : comp(high, x) ? 2 : 1; };
+
+    std::vector<std::array<std::ptrdiff_t, 3>> counts(threads);
+    auto chunk = [&](int t) { return first + n * t / threads; };
+    runThreads(threads, [&](int t) {
+        std::array<std::ptrdiff_t, 3> count = {};
+        for (It it = chunk(t), chunkLast = chunk(t + 1); it != chunkLast; ++it) ++count[block(*it)];
+        counts[t] = count;
+    });
+    std::array<std::ptrdiff_t, 4> bounds = {};
+    for (int b = 0; b < 3; ++b) {
+        bounds[b + 1] = bounds[b];
+        for (int t = 0; t < threads; ++t) {
+            std::ptrdiff_t count = counts[t][b];
+            counts[t][b] = bounds[b + 1];       // where thread t's elements of block b start
+            bounds[b + 1] += count;
+        }
+    }
+    runThreads(threads, [&](int t) {
+        std::array<std::ptrdiff_t, 3>& next = counts[t];
+        for (It it = chunk(t), chunkLast = chunk(t + 1); it != chunkLast; ++it) buffer[next[block(*it)]++] = std::move(*it);
+    });
+    runThreads(threads, [&](int t) {
+        std::move(buffer.begin() + n * t / threads, buffer.begin() + n * (t + 1) / threads, chunk(t));
+    });
+
+    std::ptrdiff_t at = nth - first;
+    int b = at < bounds[1] ? 0 : at < bounds[2] ? 1 : 2;
+    return {first + bounds[b], first + bounds[b + 1]};
+}
+
+template <class It, class Key = Identity, class Less = std::less<>>
+void parallelNthElementBy(It first, It nth, It last, Key key = {}, Less less = {}, int threads = defaultThreads()) {
+    auto comp = [&](const auto& a, const auto& b) { return less(key(a), key(b)); };
+    if (nth == last) return;
+    if (threads > 1 && last - first >= PARALLEL_MIN) {
+        auto buffer = sortBuffer(first, last);
+        std::minstd_rand random(12345);
+        while (last - first >= PARALLEL_MIN) {
+            auto [blockFirst, blockLast] = parallelNarrow(first, nth, last, comp, threads, buffer, random);
+            if (blockLast - blockFirst == last - first) break;     // no progress: all keys equal or nearly
+            first = blockFirst;
+            last = blockLast;
+        }
+    }
+    introselect(first, nth, last, comp);
+}
+
+template <class It, class Key = Identity, class Less = std::less<>>
+void parallelPartialSortBy(It first, It middle, It last, Key key = {}, Less less = {}, int threads = defaultThreads()) {
+    if (middle == first) return;
+    if (threads <= 1 || last - first < PARALLEL_MIN) {
+        partialSortBy(first, middle, last, key, less);
+        return;
+    }
+    std::ptrdiff_t k = middle - first, n = last - first;
+    if (k * HEAP_SELECT_RATIO < n && k * 2 * threads <= n) {
+        // Each thread heap-selects its share's smallest k to the front of the
+        // share; the shares' winners are swapped together and selected again.
+        auto comp = [&](const auto& a, const auto& b) { return less(key(a), key(b)); };
+        auto chunk = [&](int t) { return first + n * t / threads; };
+        runThreads(threads, [&](int t) { heapSelect(chunk(t), chunk(t) + k, chunk(t + 1), comp); });
+        for (int t = 1; t < threads; ++t) std::swap_ranges(chunk(t), chunk(t) + k, first + t * k);
+        partialSortBy(first, middle, first + threads * k, key, less);
+        return;
+    }
+    parallelNthElementBy(first, middle - 1, last, key, less, threads);
+    parallelSortBy(first, middle - 1, key, less, threads);
+}
+
+// The k smallest elements of [first, last), in order: one TopK per thread
+// over its share of the range, merged at the end.
+template <class It, class Key = Identity, class Less = std::less<>>
+std::vector<typename std::iterator_traits<It>::value_type> parallelTopK(It first, It last, size_t k, Key key = {},
+                                                                         Less less = {}, int threads = defaultThreads()) {
+    using T = typename std::iterator_traits<It>::value_type;
+    std::ptrdiff_t n = last - first;
+    if (n < PARALLEL_MIN) threads = 1;
+    std::vector<TopK<T, Key, Less>> parts(threads, TopK<T, Key, Less>(k, key, less));
+    runThreads(threads, [&](int t) {
+        It chunkLast = first + n * (t + 1) / threads;
+        for (It it = first + n * t / threads; it != chunkLast; ++it) parts[t].push(*it);
+    });
+    for (int t = 1; t < threads; ++t) parts[0].merge(std::move(parts[t]));
+    return parts[0].take();
+}
@@ -0,0 +1,428 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Generic sorting over random-access ranges. sortBy(first, last, key, less)
+// orders the elements by key(element) under less; key defaults to the element
+// itself and less to std::less<>. The algorithm is chosen at compile time from
+// the key type and the comparator, and key and less are called directly (no
+// virtual calls, no std::function):
+//
+//   integral or floating-point keys, std::less or std::greater
+//       LSD radix sort on 8-bit digits, skipping digits all keys share; stable
+//   std::string (by reference) or std::string_view keys, std::less
+//       MSD radix sort, multikey quicksort below MSD_MIN elements or past
+//       MSD_MAX_LEVELS nested buckets
+//   anything else
+//       introsort: median-of-three quicksort, heapsort past 2 log2 n levels,
+//       insertion sort below INSERTION_MAX elements; not stable
+//
+// runMergeSortBy is a natural merge sort for input that is already mostly in
+// runs, ascending or descending.
+//
+// parallelSortBy splits the range with median-of-three partitions, one
+// thread per part, and sorts each part with sortBy. key and less are then
+// called from several threads at once and must not modify shared state.
+//
+// Ranges shorter than RADIX_MIN use introsort whatever the key. The radix
+// sorts need one buffer of n elements, so the elements must be default
+// constructible or copyable, and move assignable.
+//
+// Radix keys are mapped to unsigned integers in the same order: signed
+// integers get their sign bit flipped; IEEE floats get every bit flipped when
+// negative and only the sign bit otherwise, so -0.0 sorts just before +0.0
+// and NaNs sort beyond the infinities.
+
+const std::ptrdiff_t INSERTION_MAX = 24;
+const std::ptrdiff_t RADIX_MIN = 256;
+const std::ptrdiff_t MSD_MIN = 1024;
+const int MSD_MAX_LEVELS = 64;
+const std::ptrdiff_t PARALLEL_MIN = 1 << 16;
+
+struct Identity {
+    template <class T>
+    constexpr T&& operator()(T&& x) const noexcept { return std::forward<T>(x); }
+};
+
+template <class It, class Key>
+using SortKeyRef = std::invoke_result_t<Key&, typename std::iterator_traits<It>::reference>;
+template <class It, class Key>
+using SortKey = std::decay_t<SortKeyRef<It, Key>>;
+
+// ---- key classification ----
+
+template <class K, class = void>
+struct RadixKey {
+    static constexpr bool enabled = false;
+};
+
+template <class K>
+struct RadixKey<K, std::enable_if_t<std::is_integral_v<K> && !std::is_same_v<K, bool>>> {
+    static constexpr bool enabled = true;
+    using Bits = std::make_unsigned_t<K>;
+    static Bits bits(K k) {
+        Bits b = (Bits)k;
+        if constexpr (std::is_signed_v<K>) b ^= Bits(1) << (sizeof(K) * 8 - 1);
+        return b;
+    }
+};
+
+template <class K>
+struct RadixKey<K, std::enable_if_t<std::is_floating_point_v<K> && std::numeric_limits<K>::is_iec559 &&
+                                    (sizeof(K) == 4 || sizeof(K) == 8)>> {
+    static constexpr bool enabled = true;
+    using Bits = std::conditional_t<sizeof(K) == 4, uint32_t, uint64_t>;
+    static Bits bits(K k) {
+        Bits b;
+        std::memcpy(&b, &k, sizeof b);
+        const Bits sign = Bits(1) << (sizeof(K) * 8 - 1);
+        return (b & sign) ? ~b : (b | sign);
+    }
+};
+
+// +1 for ascending, -1 for descending, 0 when the comparator is not one the
+// radix sorts can reproduce.
+template <class Less, class K>
+constexpr int radixDirection() {
+    if constexpr (std::is_same_v<Less, std::less<>> || std::is_same_v<Less, std::less<K>>) return 1;
+    else if constexpr (std::is_same_v<Less, std::greater<>> || std::is_same_v<Less, std::greater<K>>) return -1;
+    else return 0;
+}
+
+template <class It, class Key>
+constexpr bool stringKey() {
+    using Ref = SortKeyRef<It, Key>;
+    return std::is_same_v<std::decay_t<Ref>, std::string_view> ||
+           (std::is_same_v<std::decay_t<Ref>, std::string> && std::is_reference_v<Ref>);
+}
+
+enum class SortMethod { Introsort, Radix, StringRadix };
+
+template <class It, class Key = Identity, class Less = std::less<>>
+constexpr SortMethod sortMethod() {
+    using K = SortKey<It, Key>;
+    if constexpr (RadixKey<K>::enabled && radixDirection<Less, K>() != 0) return SortMethod::Radix;
+    else if constexpr (stringKey<It, Key>() && (std::is_same_v<Less, std::less<>> || std::is_same_v<Less, std::less<K>>))
+        return SortMethod::StringRadix;
+    else return SortMethod::Introsort;
+}
+
+// The method sortBy uses for n elements.
+template <class It, class Key = Identity, class Less = std::less<>>
+constexpr SortMethod sortMethodFor(std::ptrdiff_t n) {
+    return n < RADIX_MIN ? SortMethod::Introsort : sortMethod<It, Key, Less>();
+}
+
+inline const char* sortMethodName(SortMethod m) {
+    switch (m) {
+        case SortMethod::Radix: return "radix";
+        case SortMethod::StringRadix: return "msd-radix";
+        default: return "introsort";
+    }
+}
+
+// A scratch range of n elements for the radix sorts.
+template <class It>
+std::vector<typename std::iterator_traits<It>::value_type> sortBuffer(It first, It last) {
+    using T = typename std::iterator_traits<It>::value_type;
+    if constexpr (std::is_default_constructible_v<T>) return std::vector<T>(last - first);
+    else return std::vector<T>(first, last);
+}
+
+// ---- introsort ----
+
+template <class It, class Compare>
+void insertionSort(It first, It last, Compare& comp) {
+    if (first == last) return;
+    for (It i = first + 1; i != last; ++i) {
+        auto value = std::move(*i);
+        It j = i;
+        for (; j != first && comp(value, *(j - 1)); --j) *j = std::move(*(j - 1));
+        *j = std::move(value);
+    }
+}
+
+// Partitions the rest of the range around *first and puts it at its final
+// position, which is returned: nothing before it compares greater, nothing
+// after it less. Elements equal to the pivot stop both scans, so runs of
+// duplicates split evenly instead of degrading to quadratic time.
+template <class It, class Compare>
+It partitionAroundFirst(It first, It last, Compare& comp) {
+    It i = first, j = last;
+    for (;;) {
+        do ++i; while (i != last && comp(*i, *first));
+        do --j; while (comp(*first, *j));
+        if (i >= j) break;
+        std::iter_swap(i, j);
+    }
+    std::iter_swap(first, j);
+    return j;
+}
+
+// partitionAroundFirst with the median of the first, middle and last
+// elements as the pivot.
+template <class It, class Compare>
+It partitionAroundMedian(It first, It last, Compare& comp) {
+    It mid = first + (last - first) / 2, back = last - 1;
+    if (comp(*mid, *first)) std::iter_swap(mid, first);
+    if (comp(*back, *mid)) {
+        std::iter_swap(back, mid);
+        if (comp(*mid, *first)) std::iter_swap(mid, first);
+    }
+    std::iter_swap(first, mid);
+    return partitionAroundFirst(first, last, comp);
+}
+
+template <class It, class Compare>
+void introsortLoop(It first, It last, int depthLimit, Compare& comp) {
+    while (last - first > INSERTION_MAX) {
+        if (depthLimit-- == 0) {
+            std::make_heap(first, last, comp);
+            std::sort_heap(first, last, comp);
+            return;
+        }
+        It cut = partitionAroundMedian(first, last, comp);
+        // Recurse into the smaller side so the stack stays O(log n).
+        if (cut - first < last - cut) {
+            introsortLoop(first, cut, depthLimit, comp);
+            first = cut + 1;
+        } else {
+            introsortLoop(cut + 1, last, depthLimit, comp);
+            last = cut;
+        }
+    }
+    insertionSort(first, last, comp);
+}
+
+inline int introsortDepth(std::ptrdiff_t n) {
+    int depth = 0;
+    while (n > 1) {
+        n >>= 1;
+        ++depth;
+    }
+    return 2 * depth;
+}
+
+template <class It, class Compare>
+void introsort(It first, It last, Compare comp) {
+    introsortLoop(first, last, introsortDepth(last - first), comp);
+}
+
+// ---- LSD radix sort ----
+
+template <class Src, class Dst, class BitsOf>
+void radixScatter(Src src, std::ptrdiff_t n, Dst dst, int shift, size_t* offsets, BitsOf& bitsOf) {
+    for (std::ptrdiff_t i = 0; i < n; ++i) {
+        size_t digit = (size_t)(bitsOf(src[i]) >> shift) & 0xFF;
+        dst[offsets[digit]++] = std::move(src[i]);
+    }
+}
+
+template <class It, class BitsOf>
+void lsdRadixSort(It first, It last, BitsOf bitsOf) {
+    using Bits = decltype(bitsOf(*first));
+    const int DIGITS = sizeof(Bits);
+    std::ptrdiff_t n = last - first;
+    std::vector<size_t> counts(DIGITS * 256);
+    for (It it = first; it != last; ++it) {
+        Bits b = bitsOf(*it);
+        for (int d = 0; d < DIGITS; ++d) ++counts[d * 256 + ((b >> (8 * d)) & 0xFF)];
+    }
+    auto buffer = sortBuffer(first, last);
+    bool inBuffer = false;
+    for (int d = 0; d < DIGITS; ++d) {
+        size_t* count = &counts[d * 256];
+        if (std::find(count, count + 256, (size_t)n) != count + 256) continue;   // every key has this digit
+        size_t offsets[256], sum = 0;
+        for (int v = 0; v < 256; ++v) {
+            offsets[v] = sum;
+            sum += count[v];
+        }
+        if (inBuffer) radixScatter(buffer.begin(), n, first, 8 * d, offsets, bitsOf);
+        else radixScatter(first, n, buffer.begin(), 8 * d, offsets, bitsOf);
+        inBuffer = !inBuffer;
+    }
+    if (inBuffer) std::move(buffer.begin(), buffer.end(), first);
+}
+
+// ---- string keys ----
+
+// Character at depth as 1..256, or 0 past the end of the string.
+inline int keyChar(std::string_view s, size_t depth) {
+    return depth < s.size() ? (unsigned char)s[depth] + 1 : 0;
+}
+
+// Bentley-Sedgewick three-way radix quicksort on the characters from depth on.
+template <class It, class Key>
+void multikeyQuicksort(It first, It last, Key& key, size_t depth) {
+    while (last - first > INSERTION_MAX) {
+        auto charOf = [&](It it) { return keyChar(key(*it), depth); };
+        int a = charOf(first), b = charOf(first + (last - first) / 2), c = charOf(last - 1);
+        int pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+        It lt = first, i = first, gt = last;
+        while (i < gt) {
+            int ch = charOf(i);
+            if (ch < pivot) std::iter_swap(lt++, i++);
+            else if (ch > pivot) std::iter_swap(i, --gt);
+            else ++i;
+        }
+        if (lt - first < last - gt) {
+            multikeyQuicksort(first, lt, key, depth);
+            multikeyQuicksort(gt, last, key, depth);
+        } else {
+            multikeyQuicksort(gt, last, key, depth);
+            multikeyQuicksort(first, lt, key, depth);
+        }
+        if (pivot == 0) return;     // the middle keys all end here: equal
+        first = lt;
+        last = gt;
+        ++depth;
+    }
+    auto tailLess = [&](const auto& x, const auto& y) {
+        std::string_view s = key(x), t = key(y);
+        return s.substr(std::min(depth, s.size())) < t.substr(std::min(depth, t.size()));
+    };
+    insertionSort(first, last, tailLess);
+}
+
+// Keys sharing a long prefix are not a recursion per shared character: a
+// depth where every key falls in one bucket only advances depth. Ranges still
+// large after MSD_MAX_LEVELS nested buckets go to multikey quicksort, which
+// loops on its middle partition, so the stack stays bounded.
+template <class It, class Key, class Buffer>
+void msdRadixSort(It first, It last, Key& key, size_t depth, Buffer& buffer, int level = 0) {
+    std::ptrdiff_t n = last - first;
+    if (n < MSD_MIN || level >= MSD_MAX_LEVELS) {
+        multikeyQuicksort(first, last, key, depth);
+        return;
+    }
+    size_t starts[258];
+    for (;; ++depth) {
+        std::fill(starts, starts + 258, 0);
+        for (It it = first; it != last; ++it) ++starts[keyChar(key(*it), depth) + 1];
+        int c = keyChar(key(*first), depth);
+        if (starts[c + 1] != (size_t)n) break;
+        if (c == 0) return;     // every key ends here: all equal
+    }
+    for (int c = 1; c < 258; ++c) starts[c] += starts[c - 1];
+    size_t next[257];
+    std::copy(starts, starts + 257, next);
+    for (It it = first; it != last; ++it) buffer[next[keyChar(key(*it), depth)]++] = std::move(*it);
+    std::move(buffer.begin(), buffer.begin() + n, first);
+    // Bucket 0 holds keys that end at this depth: all equal.
+    for (int c = 1; c < 257; ++c)
+        if (starts[c + 1] - starts[c] > 1)
+            msdRadixSort(first + starts[c], first + starts[c + 1], key, depth + 1, buffer, level + 1);
+}
+
+// ---- entry point ----
+
+template <class It, class Key = Identity, class Less = std::less<>>
+void sortBy(It first, It last, Key key = {}, Less less = {}) {
+    constexpr SortMethod method = sortMethod<It, Key, Less>();
+    if (sortMethodFor<It, Key, Less>(last - first) == SortMethod::Introsort) {
+        auto comp = [&](const auto& a, const auto& b) { return less(key(a), key(b)); };
+        introsort(first, last, comp);
+    } else if constexpr (method == SortMethod::Radix) {
+        using K = SortKey<It, Key>;
+        using Bits = typename RadixKey<K>::Bits;
+        if constexpr (radixDirection<Less, K>() > 0) {
+            lsdRadixSort(first, last, [&](const auto& x) -> Bits { return RadixKey<K>::bits(key(x)); });
+        } else {
+            lsdRadixSort(first, last, [&](const auto& x) -> Bits { return (Bits)~RadixKey<K>::bits(key(x)); });
+        }
+    } else if constexpr (method == SortMethod::StringRadix) {
+        auto buffer = sortBuffer(first, last);
+        msdRadixSort(first, last, key, 0, buffer);
+    }
+}
+
+// ---- natural merge sort ----
+
+// Splits [first, last) into maximal runs, reversing strictly descending ones,
+// and returns the run boundaries: first, the end of each run, last.
+template <class It, class Compare>
+std::vector<It> findRuns(It first, It last, Compare& comp) {
+    std::vector<It> bounds{first};
+    It start = first;
+    while (start != last) {
+        It end = start + 1;
+        if (end != last && comp(*end, *start)) {
+            while (end != last && comp(*end, *(end - 1))) ++end;
+            std::reverse(start, end);
+        } else {
+            while (end != last && !comp(*end, *(end - 1))) ++end;
+        }
+        bounds.push_back(end);
+        start = end;
+    }
+    return bounds;
+}
+
+// Stable, and O(n log r) for r runs: linear on sorted or reversed input.
+// Adjacent runs are merged pairwise, the left run through a buffer.
+template <class It, class Key = Identity, class Less = std::less<>>
+void runMergeSortBy(It first, It last, Key key = {}, Less less = {}) {
+    auto comp = [&](const auto& a, const auto& b) { return less(key(a), key(b)); };
+    std::vector<It> bounds = findRuns(first, last, comp);
+    if (bounds.size() <= 2) return;
+    auto buffer = sortBuffer(first, last);
+    while (bounds.size() > 2) {
+        std::vector<It> merged{first};
+        for (size_t r = 0; r + 2 < bounds.size(); r += 2) {
+            It left = bounds[r], mid = bounds[r + 1], right = bounds[r + 2];
+            auto leftEnd = std::move(left, mid, buffer.begin());
+            auto i = buffer.begin();
+            It j = mid, out = left;
+            while (i != leftEnd && j != right) *out++ = comp(*j, *i) ? std::move(*j++) : std::move(*i++);
+            std::move(i, leftEnd, out);
+            merged.push_back(right);
+        }
+        if (bounds.size() % 2 == 0) merged.push_back(last);     // odd run count: the last run waits
+        bounds = std::move(merged);
+    }
+}
+
+// ---- parallel ----
+
+inline int defaultThreads() { return std::max(1u, std::thread::hardware_concurrency()); }
+
+// Runs f(0) ... f(threads - 1), f(0) on the calling thread.
+template <class F>
+void runThreads(int threads, F f) {
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(f, t);
+    f(0);
+    for (std::thread& worker : pool) worker.join();
+}
+
+template <class It, class Key, class Less, class Compare>
+void parallelSortLoop(It first, It last, int threads, Key& key, Less& less, Compare& comp) {
+    if (threads <= 1 || last - first < PARALLEL_MIN) {
+        sortBy(first, last, key, less);
+        return;
+    }
+    It cut = partitionAroundMedian(first, last, comp);
+    int leftThreads = threads / 2;
+    std::thread left([&] { parallelSortLoop(first, cut, leftThreads, key, less, comp); });
+    parallelSortLoop(cut + 1, last, threads - leftThreads, key, less, comp);
+    left.join();
+}
+
+template <class It, class Key = Identity, class Less = std::less<>>
+void parallelSortBy(It first, It last, Key key = {}, Less less = {}, int threads = defaultThreads()) {
+    auto comp = [&](const auto& a, const auto& b) { return less(key(a), key(b)); };
+    parallelSortLoop(first, last, threads, key, less, comp);
+}
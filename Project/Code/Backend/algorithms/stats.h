@@ -0,0 +1,190 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// Opt-in run instrumentation. A binary declares `StatsReport report("name");`
+// at the top of main; when it goes out of scope one
+// {"type":"stats", ...} record is written with wall time, the operation
+// counters below, named phase timings and, on Linux, hardware counters. The
+// server turns that record into a named SSE event and aggregates it per
+// algorithm, so it never reaches the step visualizers.
+//
+// Counters are plain integers: bump them only from the thread running main.
+// Heap allocations (every thread) are counted by the operator new below and
+// reported as the "allocations" and "allocatedBytes" counters.
+
+enum class Stat { Comparisons, Swaps, Relaxations, HeapPushes, HeapPops, DpCells, Nodes, Edges, Count };
+
+inline const char* statName(Stat s) {
+    static const char* names[] = {"comparisons", "swaps", "relaxations", "heapPushes", "heapPops", "dpCells", "nodes", "edges"};
+    return names[(int)s];
+}
+
+// Cycles, instructions, cache misses and branch misses for this process and
+// the threads it starts (inherit), counted in user space only. Unavailable
+// when perf_event_open is refused (kernel.perf_event_paranoid, containers).
+class PerfCounters {
+    static const int EVENTS = 4;
+    int fds[EVENTS] = {-1, -1, -1, -1};
+
+public:
+    static const char* name(int i) {
+        static const char* names[EVENTS] = {"cycles", "instructions", "cacheMisses", "branchMisses"};
+        return names[i];
+    }
+
+    PerfCounters() {
+#ifdef __linux__
+        const uint64_t configs[EVENTS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                          PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (int i = 0; i < EVENTS; ++i) {
+            perf_event_attr attr{};
+            attr.size = sizeof attr;
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.inherit = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int fd : fds)
+            if (fd >= 0) close(fd);
+#endif
+    }
+
+    // Value of event i scaled for multiplexing, or -1 when it is not counted.
+    long long read(int i) const {
+#ifdef __linux__
+        uint64_t v[3];
+        if (fds[i] < 0 || ::read(fds[i], v, sizeof v) != (ssize_t)sizeof v || v[2] == 0) return -1;
+        return (long long)(v[0] * ((double)v[1] / v[2]));
+#else
+        (void)i;
+        return -1;
+#endif
+    }
+
+    int size() const { return EVENTS; }
+};
+
+inline std::atomic<long long> heapAllocations{0}, heapAllocatedBytes{0};
+
+// Replacements of the global allocation functions. Each binary is a single
+// translation unit, so defining them in this header is one definition per program.
+// The deletes stay out of line: inlined into callers, GCC pairs the free with
+// the new expression and warns about a mismatch.
+void* operator new(std::size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    heapAllocatedBytes.fetch_add((long long)size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+#ifdef __GNUC__
+__attribute__((noinline))
+#endif
+void operator delete(void* p) noexcept { std::free(p); }
+#ifdef __GNUC__
+__attribute__((noinline))
+#endif
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+struct StatsRegistry {
+    std::array<long long, (size_t)Stat::Count> counters{};
+    std::vector<std::pair<std::string, double>> phases;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    PerfCounters perf;
+
+    void addPhase(const std::string& name, double ms) {
+        for (auto& p : phases)
+            if (p.first == name) {
+                p.second += ms;
+                return;
+            }
+        phases.emplace_back(name, ms);
+    }
+};
+
+inline StatsRegistry statsRegistry;
+
+inline void statAdd(Stat s, long long n = 1) { statsRegistry.counters[(size_t)s] += n; }
+
+// Adds the lifetime of the object to the named phase.
+class ScopedTimer {
+    std::string name;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+public:
+    explicit ScopedTimer(std::string phase) : name(std::move(phase)) {}
+    ~ScopedTimer() {
+        statsRegistry.addPhase(name, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+    }
+};
+
+class StatsReport {
+    std::string algorithm;
+
+public:
+    explicit StatsReport(std::string name) : algorithm(std::move(name)) {}
+    void rename(const std::string& name) { algorithm = name; }
+
+    ~StatsReport() {
+        StatsRegistry& r = statsRegistry;
+        std::ostringstream out;
+        out << "{\"type\":\"stats\",\"algorithm\":\"" << algorithm << "\",\"wallMs\":"
+            << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - r.start).count();
+        out << ",\"counters\":{";
+        bool first = true;
+        for (size_t i = 0; i < r.counters.size(); ++i) {
+            if (!r.counters[i]) continue;
+            out << (first ? "" : ",") << "\"" << statName((Stat)i) << "\":" << r.counters[i];
+            first = false;
+        }
+        out << (first ? "" : ",") << "\"allocations\":" << heapAllocations.load()
+            << ",\"allocatedBytes\":" << heapAllocatedBytes.load();
+        out << "},\"phases\":{";
+        for (size_t i = 0; i < r.phases.size(); ++i)
+            out << (i ? "," : "") << "\"" << r.phases[i].first << "\":" << r.phases[i].second;
+        out << "},\"perf\":";
+        std::ostringstream perf;
+        first = true;
+        for (int i = 0; i < r.perf.size(); ++i) {
+            long long v = r.perf.read(i);
+            if (v < 0) continue;
+            perf << (first ? "{" : ",") << "\"" << PerfCounters::name(i) << "\":" << v;
+            first = false;
+        }
+        out << (first ? "null" : perf.str() + "}");
+#ifndef _WIN32
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        out << ",\"maxRssKb\":" << usage.ru_maxrss;
+#endif
+        out << "}";
+        std::cout << out.str() << std::endl;
+    }
+};
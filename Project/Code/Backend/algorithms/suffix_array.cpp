@@ -0,0 +1,426 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "trace.h"
+#include "stats.h"
+
+using namespace std;
+using namespace std::chrono;
+
+const size_t TRACE_LIMIT = 256;              // longer texts are indexed without per-step output
+const int LCP_SCAN_LIMIT = 64;               // occurrences walked along the LCP array before binary search
+const size_t SHOW_LIMIT = 16;                // positions listed per query in batch mode
+const uint32_t INDEX_VERSION = 1;
+const char INDEX_MAGIC[8] = {'S', 'A', 'I', 'N', 'D', 'E', 'X', '\0'};
+
+bool traceOn = true;
+
+void logStep(const string& text,
+             const string& pattern,
+             int l,
+             int r,
+             const string& message) {
+    if (!traceOn || !traceKeep(traceImportant(message))) return;
+    cout << "{";
+    cout << "\"type\":\"Suffix Array\", ";
+    if (l >= 0)     cout << "\"l\":"       << l       << ", ";
+    if (r >= 0)     cout << "\"r\":"       << r       << ", ";
+    cout << "\"text\":\""    << text    << "\", ";
+    cout << "\"pattern\":\"" << pattern << "\", ";
+    cout << "\"message\":\"" << message << "\"";
+    cout << "}" << endl;
+}
+
+// SA-IS: classify suffixes as S or L type, sort the LMS substrings by induced
+// sorting, name them, recurse on the reduced string when names repeat, and
+// induce the full order from the sorted LMS suffixes. Linear time.
+template <typename Symbol>
+vector<int> saIs(const Symbol* s, int n, int upper) {
+    if (n == 0) return {};
+    if (n == 1) return {0};
+    if (n == 2) return s[0] < s[1] ? vector<int>{0, 1} : vector<int>{1, 0};
+
+    vector<int> sa(n);
+    vector<char> isS(n, 0);
+    for (int i = n - 2; i >= 0; --i) isS[i] = s[i] == s[i + 1] ? isS[i + 1] : s[i] < s[i + 1];
+
+    // Bucket starts: L-type suffixes of symbol c go first, then S-type.
+    vector<int> startL(upper + 1, 0), startS(upper + 1, 0);
+    for (int i = 0; i < n; ++i) {
+        if (!isS[i]) startS[s[i]]++;
+        else startL[s[i] + 1]++;
+    }
+    for (int c = 0; c <= upper; ++c) {
+        startS[c] += startL[c];
+        if (c < upper) startL[c + 1] += startS[c];
+    }
+
+    auto induce = [&](const vector<int>& lms) {
+        fill(sa.begin(), sa.end(), -1);
+        vector<int> bucket(startS);
+        for (int d : lms)
+            if (d != n) sa[bucket[s[d]]++] = d;
+        bucket = startL;
+        sa[bucket[s[n - 1]]++] = n - 1;
+        for (int i = 0; i < n; ++i) {
+            int v = sa[i];
+            if (v >= 1 && !isS[v - 1]) sa[bucket[s[v - 1]]++] = v - 1;
+        }
+        bucket = startL;
+        for (int i = n - 1; i >= 0; --i) {
+            int v = sa[i];
+            if (v >= 1 && isS[v - 1]) sa[--bucket[s[v - 1] + 1]] = v - 1;
+        }
+    };
+
+    vector<int> lmsIndex(n + 1, -1), lms;
+    for (int i = 1; i < n; ++i)
+        if (!isS[i - 1] && isS[i]) {
+            lmsIndex[i] = lms.size();
+            lms.push_back(i);
+        }
+    int m = lms.size();
+    induce(lms);
+    if (m == 0) return sa;
+
+    vector<int> sortedLms;
+    sortedLms.reserve(m);
+    for (int v : sa)
+        if (lmsIndex[v] != -1) sortedLms.push_back(v);
+
+    // Name LMS substrings; equal substrings share a name.
+    vector<int> reduced(m);
+    int names = 0;
+    reduced[lmsIndex[sortedLms[0]]] = 0;
+    for (int i = 1; i < m; ++i) {
+        int l = sortedLms[i - 1], r = sortedLms[i];
+        int endL = lmsIndex[l] + 1 < m ? lms[lmsIndex[l] + 1] : n;
+        int endR = lmsIndex[r] + 1 < m ? lms[lmsIndex[r] + 1] : n;
+        bool same = endL - l == endR - r;
+        if (same) {
+            while (l < endL && s[l] == s[r]) ++l, ++r;
+            if (l == n || s[l] != s[r]) same = false;
+        }
+        if (!same) ++names;
+        reduced[lmsIndex[sortedLms[i]]] = names;
+    }
+
+    vector<int> reducedSa = saIs(reduced.data(), m, names);
+    for (int i = 0; i < m; ++i) sortedLms[i] = lms[reducedSa[i]];
+    induce(sortedLms);
+    return sa;
+}
+
+// Kasai: walking suffixes in text order, the LCP with the previous suffix in
+// SA order drops by at most one per step. lcp[i] = lcp(sa[i - 1], sa[i]).
+vector<int> kasaiLcp(const unsigned char* text, const vector<int>& sa) {
+    int n = sa.size();
+    vector<int> rank(n), lcp(n, 0);
+    for (int i = 0; i < n; ++i) rank[sa[i]] = i;
+    for (int i = 0, h = 0; i < n; ++i) {
+        if (rank[i] == 0) {
+            h = 0;
+            continue;
+        }
+        int j = sa[rank[i] - 1];
+        while (i + h < n && j + h < n && text[i + h] == text[j + h]) ++h;
+        lcp[rank[i]] = h;
+        if (h > 0) --h;
+    }
+    return lcp;
+}
+
+// On-disk layout: header, then text, SA and LCP, each section starting on a
+// 64-byte boundary so the arrays can be used straight from a mapping.
+struct IndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t n;
+    uint64_t textOffset, saOffset, lcpOffset, fileSize;
+};
+
+uint64_t alignUp(uint64_t x) { return (x + 63) & ~63ULL; }
+
+IndexHeader layoutFor(uint64_t n) {
+    IndexHeader h{};
+    memcpy(h.magic, INDEX_MAGIC, sizeof h.magic);
+    h.version = INDEX_VERSION;
+    h.n = n;
+    h.textOffset = alignUp(sizeof(IndexHeader));
+    h.saOffset = alignUp(h.textOffset + n);
+    h.lcpOffset = alignUp(h.saOffset + n * sizeof(int32_t));
+    h.fileSize = h.lcpOffset + n * sizeof(int32_t);
+    return h;
+}
+
+// Read-only view of text + SA + LCP, either built in memory or mapped from an
+// index file.
+class SuffixIndex {
+    string ownedText;
+    vector<int> ownedSa, ownedLcp;
+    const char* mapped = nullptr;
+    size_t mappedSize = 0;
+    vector<char> loaded;                       // fallback when mapping is unavailable
+
+public:
+    const unsigned char* text = nullptr;
+    const int32_t* sa = nullptr;
+    const int32_t* lcp = nullptr;
+    int n = 0;
+
+    SuffixIndex() = default;
+    SuffixIndex(const SuffixIndex&) = delete;
+    SuffixIndex& operator=(const SuffixIndex&) = delete;
+
+    ~SuffixIndex() {
+#ifndef _WIN32
+        if (mapped) munmap((void*)mapped, mappedSize);
+#endif
+    }
+
+    void build(string t) {
+        ownedText = move(t);
+        text = (const unsigned char*)ownedText.data();
+        n = ownedText.size();
+        ownedSa = saIs(text, n, 255);
+        ownedLcp = kasaiLcp(text, ownedSa);
+        sa = ownedSa.data();
+        lcp = ownedLcp.data();
+    }
+
+    bool save(const string& path) const {
+        IndexHeader h = layoutFor(n);
+        FILE* out = fopen(path.c_str(), "wb");
+        if (!out) return false;
+        auto writeAt = [&](uint64_t offset, const void* data, size_t bytes) {
+            static const char zeros[64] = {};
+            for (long pos = ftell(out); (uint64_t)pos < offset; pos = ftell(out))
+                fwrite(zeros, 1, min<uint64_t>(64, offset - pos), out);
+            fwrite(data, 1, bytes, out);
+        };
+        writeAt(0, &h, sizeof h);
+        writeAt(h.textOffset, text, n);
+        writeAt(h.saOffset, sa, (size_t)n * sizeof(int32_t));
+        writeAt(h.lcpOffset, lcp, (size_t)n * sizeof(int32_t));
+        bool ok = !ferror(out);
+        return fclose(out) == 0 && ok;
+    }
+
+    // Maps the index file; nothing is copied or rebuilt, so startup cost does
+    // not depend on the corpus size.
+    string load(const string& path) {
+        const char* base = nullptr;
+        size_t size = 0;
+#ifndef _WIN32
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(IndexHeader)) {
+            void* m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m != MAP_FAILED) {
+                mapped = base = (const char*)m;
+                mappedSize = size = st.st_size;
+            }
+        }
+        if (fd >= 0) close(fd);
+#endif
+        if (!base) {
+            ifstream in(path, ios::binary);
+            if (!in) return "Cannot open " + path;
+            loaded.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+            base = loaded.data();
+            size = loaded.size();
+        }
+
+        IndexHeader h;
+        if (size < sizeof h) return "Index file is truncated";
+        memcpy(&h, base, sizeof h);
+        if (memcmp(h.magic, INDEX_MAGIC, sizeof h.magic) != 0) return "Not a suffix array index";
+        if (h.version != INDEX_VERSION) return "Unsupported index version " + to_string(h.version);
+        IndexHeader expect = layoutFor(h.n);
+        if (h.n > INT32_MAX || h.saOffset != expect.saOffset || h.lcpOffset != expect.lcpOffset || size < expect.fileSize)
+            return "Index file is truncated";
+        n = h.n;
+        text = (const unsigned char*)base + h.textOffset;
+        sa = (const int32_t*)(base + h.saOffset);
+        lcp = (const int32_t*)(base + h.lcpOffset);
+        return "";
+    }
+
+    string textString() const { return string((const char*)text, n); }
+
+    // Compares the pattern with the suffix at sa[mid], skipping the first k
+    // characters already known to match. Returns the new match length and sets
+    // `less` when the suffix sorts before the pattern.
+    int compareAt(const string& p, int mid, int k, bool& less) const {
+        int start = sa[mid], m = p.size();
+        while (k < m && start + k < n && (unsigned char)p[k] == text[start + k]) ++k;
+        less = k < m && (start + k == n || text[start + k] < (unsigned char)p[k]);
+        return k;
+    }
+
+    // Binary search with the Manber-Myers skip: every suffix between lo and hi
+    // shares at least min(lcp(P, lo), lcp(P, hi)) characters with P, so the
+    // comparison at mid starts there instead of at 0. With `upper` the search
+    // finds the first suffix that sorts after every suffix starting with P.
+    int bound(const string& p, bool upper, const string& shown) const {
+        int lo = -1, hi = n, lcpLo = 0, lcpHi = 0, m = p.size();
+        while (hi - lo > 1) {
+            int mid = lo + (hi - lo) / 2;
+            bool less;
+            int k = compareAt(p, mid, min(lcpLo, lcpHi), less);
+            logStep(shown, p, sa[mid], k, "Comparing with suffix at " + to_string(sa[mid]) + ", " + to_string(k) + " characters match");
+            if (less || (upper && k == m)) {
+                lo = mid;
+                lcpLo = k;
+            } else {
+                hi = mid;
+                lcpHi = k;
+            }
+        }
+        return hi;
+    }
+
+    // SA range [first, last) of suffixes starting with p. Short runs are
+    // extended along the LCP array; long ones fall back to a second search.
+    pair<int, int> range(const string& p, const string& shown = "") const {
+        int m = p.size();
+        if (m == 0) return {0, n};
+        int first = bound(p, false, shown);
+        bool less;
+        if (first == n || compareAt(p, first, 0, less) < m) return {first, first};
+        int last = first + 1;
+        while (last < n && last - first < LCP_SCAN_LIMIT && lcp[last] >= m) ++last;
+        if (last < n && lcp[last] >= m) last = bound(p, true, shown);
+        return {first, last};
+    }
+};
+
+string readFile(const string& path) {
+    ifstream in(path, ios::binary);
+    stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+double msSince(steady_clock::time_point start) {
+    return duration_cast<duration<double, milli>>(steady_clock::now() - start).count();
+}
+
+void printError(const string& message) {
+    cout << "{\"type\":\"error\",\"message\":\"" << message << "\"}" << endl;
+}
+
+int buildIndex(const string& textPath, const string& indexPath) {
+    traceOn = false;
+    auto start = steady_clock::now();
+    string text = readFile(textPath);
+    if (text.size() > INT32_MAX) {
+        printError("Text is larger than 2 GB");
+        return 1;
+    }
+    SuffixIndex index;
+    index.build(move(text));
+    double buildMs = msSince(start);
+    if (!index.save(indexPath)) {
+        printError("Cannot write " + indexPath);
+        return 1;
+    }
+    int longest = index.n ? *max_element(index.lcp, index.lcp + index.n) : 0;
+    cout << "{\"type\":\"Suffix Array\", \"action\":\"final\", "
+         << "\"bytes\":" << index.n << ", "
+         << "\"buildMs\":" << buildMs << ", "
+         << "\"longestRepeat\":" << longest << ", "
+         << "\"indexBytes\":" << layoutFor(index.n).fileSize << "}" << endl;
+    return 0;
+}
+
+// query <index> <pattern | @file>...: one record per pattern with its count and
+// the first few positions in text order.
+int queryIndex(const string& indexPath, const vector<string>& args) {
+    traceOn = false;
+    auto start = steady_clock::now();
+    SuffixIndex index;
+    string error = index.load(indexPath);
+    if (!error.empty()) {
+        printError(error);
+        return 1;
+    }
+    double loadMs = msSince(start);
+
+    vector<string> patterns;
+    for (auto& a : args) {
+        if (a.size() > 1 && a[0] == '@') {
+            ifstream in(a.substr(1));
+            for (string line; getline(in, line); )
+                if (!line.empty()) patterns.push_back(line);
+        } else {
+            patterns.push_back(a);
+        }
+    }
+
+    auto queryStart = steady_clock::now();
+    long long total = 0;
+    string out;
+    for (size_t id = 0; id < patterns.size(); ++id) {
+        auto [first, last] = index.range(patterns[id]);
+        vector<int> shown(index.sa + first, index.sa + last);
+        size_t keep = min(shown.size(), SHOW_LIMIT);
+        partial_sort(shown.begin(), shown.begin() + keep, shown.end());
+        total += last - first;
+        out += "{\"type\":\"Suffix Array\", \"pattern\":" + to_string(id) + ", \"count\":" + to_string(last - first) + ", \"positions\":[";
+        for (size_t i = 0; i < keep; ++i) out += (i ? "," : "") + to_string(shown[i]);
+        out += "]}\n";
+    }
+    double queryMs = msSince(queryStart);
+    cout << out;
+    cout << "{\"type\":\"Suffix Array\", \"action\":\"final\", "
+         << "\"queries\":" << patterns.size() << ", "
+         << "\"matches\":" << total << ", "
+         << "\"loadMs\":" << loadMs << ", "
+         << "\"queriesPerSec\":" << (queryMs > 0 ? patterns.size() / queryMs * 1000 : 0) << "}" << endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    StatsReport report(argc > 3 && (string(argv[1]) == "build" || string(argv[1]) == "query") ? "suffix-array-" + string(argv[1]) : "suffix-array");
+    if (argc > 3 && string(argv[1]) == "build") return buildIndex(argv[2], argv[3]);
+    if (argc > 3 && string(argv[1]) == "query") return queryIndex(argv[2], vector<string>(argv + 3, argv + argc));
+
+    string text    = "banana";
+    string pattern = "ana";
+    if (argc > 1) text = argv[1];
+    if (argc > 2) pattern = argv[2];
+    traceOn = text.size() <= TRACE_LIMIT;
+
+    SuffixIndex index;
+    index.build(text);
+    logStep(text, pattern, -1, -1, "Starting suffix array search");
+    for (int i = 0; i < index.n; ++i)
+        logStep(text, pattern, index.sa[i], index.lcp[i],
+                "Rank " + to_string(i) + ": suffix at " + to_string(index.sa[i]) + ", LCP with previous " + to_string(index.lcp[i]));
+
+    auto [first, last] = index.range(pattern, text);
+    vector<int> positions(index.sa + first, index.sa + last);
+    sort(positions.begin(), positions.end());
+    for (int pos : positions)
+        logStep(text, pattern, pos, pattern.size(), "Pattern found at index " + to_string(pos));
+    if (positions.empty()) logStep(text, pattern, -1, -1, "Pattern not found");
+    if (traceOn) return 0;
+    for (int pos : positions) cout << "{\"type\":\"Suffix Array\", \"match\":" << pos << "}" << endl;
+    cout << "{\"type\":\"Suffix Array\", \"action\":\"final\", \"matches\":" << positions.size() << "}" << endl;
+    return 0;
+}
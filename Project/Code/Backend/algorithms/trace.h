@@ -0,0 +1,268 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+// Step rate control shared by the trace emitters. When the server sets
+// TRACE_MAX_RATE (steps per second, requested by the client), a token bucket
+// holding up to one second of steps decides which intermediate steps are
+// written; the rest are dropped here rather than after serialization in JS.
+// Important steps (results, start and end markers) are always written.
+struct TraceGate {
+    double rate = 0;
+    double tokens = 0;
+    std::chrono::steady_clock::time_point last;
+    long long dropped = 0;
+
+    TraceGate() {
+        if (const char* env = std::getenv("TRACE_MAX_RATE")) rate = std::max(0.0, std::atof(env));
+        tokens = rate;
+        last = std::chrono::steady_clock::now();
+    }
+};
+
+inline TraceGate& traceGate() {
+    static TraceGate gate;
+    return gate;
+}
+
+inline bool traceKeep(bool important = false) {
+    TraceGate& gate = traceGate();
+    if (gate.rate <= 0) return true;
+    auto now = std::chrono::steady_clock::now();
+    gate.tokens = std::min(gate.rate, gate.tokens + gate.rate * std::chrono::duration<double>(now - gate.last).count());
+    gate.last = now;
+    if (gate.tokens >= 1) {
+        gate.tokens -= 1;
+        return true;
+    }
+    if (important) return true;
+    ++gate.dropped;
+    return false;
+}
+
+// Messages that report an outcome or a phase boundary are never dropped.
+inline bool traceImportant(std::string_view message) {
+    auto sameLower = [](char c, char word) { return std::tolower((unsigned char)c) == word; };
+    for (std::string_view word : {"found", "start", "final", "complete", "solution", "error", "stopped"})
+        if (std::search(message.begin(), message.end(), word.begin(), word.end(), sameLower) != message.end()) return true;
+    return false;
+}
+
+inline long long traceDropped() { return traceGate().dropped; }
+
+// s as the inside of a JSON string: input text and patterns reach the steps
+// verbatim, quotes, backslashes and control characters included.
+inline std::string jsonEscape(std::string_view s) {
+    std::string out;
+    out.reserve(s.size());
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            out += "\\u00";
+            out += "0123456789abcdef"[c >> 4];
+            out += "0123456789abcdef"[c & 15];
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+// Seekable trace store. When the server sets TRACE_FILE=<base>, every step
+// line written to stdout is also appended to files the server reads back for
+// GET /trace/:runId:
+//
+//   <base>.trace  the step lines in stream order (stats, progress and
+//                 decision records are not steps and are left out)
+//   <base>.idx    "TRACEIDX", uint32 version, uint32 interval, then one record
+//                 of two int64 per `interval` steps: the byte offset of step
+//                 k * interval in .trace, and the offset in .keys of the last
+//                 keyframe written before it (-1 if none)
+//   <base>.keys   keyframe lines {"step":S,"state":{...}}: the full state
+//                 before step S, for traces whose steps are deltas
+//
+// Reaching step s reads one index record and skips fewer than `interval`
+// lines. Binaries whose steps each carry the whole state (sorting arrays,
+// boards) need no keyframes; the others call traceKeyframe when
+// traceKeyframeDue says so. Integers are written in native (little-endian)
+// byte order.
+const uint32_t TRACE_INDEX_VERSION = 1;
+const uint32_t TRACE_INDEX_INTERVAL = 256;
+const long long TRACE_KEYFRAME_STEPS = 4096;
+const long long TRACE_FLUSH_MS = 100;
+
+// Stands in for cout's buffer: collects output in its own buffer and, at
+// every flush (endl) or when the buffer fills, passes it on unchanged and
+// captures the complete lines. Like any buffered stream it must not be
+// written from two threads at once; the progress records budget.h writes
+// from worker threads are serialized by its print lock.
+class TraceTee : public std::streambuf {
+    std::streambuf* out;
+    std::FILE* trace;
+    std::FILE* index;
+    std::FILE* keys;
+    std::mutex lock;
+    char buffer[1 << 13];
+    std::string line;
+    long long traceBytes = 0, keysBytes = 0, lastKeyframe = -1;
+    std::chrono::steady_clock::time_point flushed = std::chrono::steady_clock::now();
+
+    static bool isStep(const std::string& line) {
+        for (const char* record : {"{\"type\":\"stats\"", "{\"type\":\"progress\"", "{\"type\":\"decision\""})
+            if (line.rfind(record, 0) == 0) return false;
+        return !line.empty();
+    }
+
+    void capture(const char* data, const char* end) {
+        while (data < end) {
+            const char* newline = (const char*)std::memchr(data, '\n', end - data);
+            line.append(data, newline ? newline : end);
+            if (!newline) return;
+            data = newline + 1;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (isStep(line)) {
+                if (steps.load() % TRACE_INDEX_INTERVAL == 0) {
+                    int64_t record[2] = {traceBytes, lastKeyframe};
+                    std::fwrite(record, sizeof record, 1, index);
+                }
+                line.push_back('\n');
+                std::fwrite(line.data(), 1, line.size(), trace);
+                traceBytes += (long long)line.size();
+                ++steps;
+            }
+            line.clear();
+        }
+    }
+
+    bool drain() {
+        std::streamsize n = pptr() - pbase();
+        capture(pbase(), pptr());
+        setp(buffer, buffer + sizeof buffer);
+        return out->sputn(buffer, n) == n;
+    }
+
+    void flushFiles() {
+        std::fflush(trace);
+        std::fflush(keys);
+        std::fflush(index);
+        flushed = std::chrono::steady_clock::now();
+    }
+
+protected:
+    int overflow(int c) override {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!drain()) return traits_type::eof();
+        if (c != traits_type::eof()) {
+            *pptr() = (char)c;
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    // The files are flushed at most every TRACE_FLUSH_MS, so the store adds
+    // no system call per step.
+    int sync() override {
+        std::lock_guard<std::mutex> guard(lock);
+        bool ok = drain();
+        if (std::chrono::steady_clock::now() - flushed >= std::chrono::milliseconds(TRACE_FLUSH_MS)) flushFiles();
+        return ok && out->pubsync() == 0 ? 0 : -1;
+    }
+
+public:
+    std::atomic<long long> steps{0}, keyframeStep{0};
+
+    TraceTee(std::streambuf* target, std::FILE* t, std::FILE* i, std::FILE* k) : out(target), trace(t), index(i), keys(k) {
+        setp(buffer, buffer + sizeof buffer);
+        line.reserve(256);
+        char magic[8];
+        std::memcpy(magic, "TRACEIDX", 8);
+        uint32_t header[2] = {TRACE_INDEX_VERSION, TRACE_INDEX_INTERVAL};
+        std::fwrite(magic, 1, 8, index);
+        std::fwrite(header, sizeof header, 1, index);
+    }
+
+    ~TraceTee() override {
+        flushFiles();
+        std::fclose(trace);
+        std::fclose(index);
+        std::fclose(keys);
+    }
+
+    void keyframe(std::string_view state) {
+        std::lock_guard<std::mutex> guard(lock);
+        drain();
+        std::string head = "{\"step\":" + std::to_string(steps) + ",\"state\":";
+        std::fwrite(head.data(), 1, head.size(), keys);
+        std::fwrite(state.data(), 1, state.size(), keys);
+        std::fwrite("}\n", 1, 2, keys);
+        lastKeyframe = keysBytes;
+        keysBytes += (long long)(head.size() + state.size() + 2);
+        keyframeStep = steps.load();
+    }
+};
+
+class TraceStore {
+    std::ios_base::Init streams;    // cout exists before it is redirected
+    std::streambuf* original = nullptr;
+    TraceTee* tee = nullptr;
+
+public:
+    TraceStore() {
+        const char* base = std::getenv("TRACE_FILE");
+        if (!base || !*base) return;
+        std::string path(base);
+        unsetenv("TRACE_FILE");     // children this run starts must not reopen (and truncate) the files
+        std::FILE* trace = std::fopen((path + ".trace").c_str(), "wb");
+        std::FILE* index = std::fopen((path + ".idx").c_str(), "wb");
+        std::FILE* keys = std::fopen((path + ".keys").c_str(), "wb");
+        if (!trace || !index || !keys) {
+            for (std::FILE* f : {trace, index, keys})
+                if (f) std::fclose(f);
+            std::cerr << "Cannot write trace files at " << path << std::endl;
+            return;
+        }
+        std::cout.flush();
+        original = std::cout.rdbuf();
+        tee = new TraceTee(original, trace, index, keys);
+        std::cout.rdbuf(tee);
+    }
+
+    ~TraceStore() {
+        if (!tee) return;
+        std::cout.flush();
+        std::cout.rdbuf(original);
+        delete tee;
+    }
+
+    TraceStore(const TraceStore&) = delete;
+    TraceStore& operator=(const TraceStore&) = delete;
+
+    TraceTee* active() { return tee; }
+};
+
+// Installed before main when TRACE_FILE is set.
+inline TraceStore traceStore;
+
+inline bool traceKeyframeDue() {
+    TraceTee* tee = traceStore.active();
+    return tee && tee->steps - tee->keyframeStep >= TRACE_KEYFRAME_STEPS;
+}
+
+// Records `state` (a JSON value) as the state before the next step.
+inline void traceKeyframe(std::string_view state) {
+    if (TraceTee* tee = traceStore.active()) tee->keyframe(state);
+}
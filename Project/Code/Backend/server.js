@@ -1,25 +1,141 @@
 const express = require('express');
 const cors = require('cors');
 const { spawn } = require('child_process');
+const fs = require('fs');
+const os = require('os');
 const path = require('path');
+const TraceCache = require('./traceCache');
+const TraceStore = require('./traceStore');
+const pseudocode = require('./algorithms/pseudocode.json');
 
 const app = express();
 app.use(cors());
 app.use(express.json());
 
+// Each client reads the current run through its own cursor: lines are written
+// until res.write reports a full buffer, and the rest waits for 'drain'.
 let clients = [];
 let lastChoice = '';
 let userParams = [];
+let maxStepsPerSecond = 0;
+let searchLimits = {};
+// The latest run, so a /stream that connects late still sees every step;
+// dropped once a finished run has been delivered.
+let currentRun = null;
+
+// The child is paused while any client reading from memory is more than
+// HIGH_WATER lines behind and resumed once every such client is within
+// LOW_WATER; its writes then block on the full pipe, so a slow browser slows
+// the algorithm instead of growing buffers. A run nobody is reading is never
+// paused: its steps go to the stored trace.
+const HIGH_WATER = 2000;
+const LOW_WATER = 500;
+// A run keeps its last LIVE_LINES steps in memory (and any its readers have
+// yet to read); clients further behind read them back from the stored trace,
+// retrying after STORE_RETRY_MS for steps the binary has not flushed yet.
+const LIVE_LINES = 5000;
+const STORE_RETRY_MS = 100;
+// ?batch=1 clients get up to BATCH_LINES steps per 'batch' event, flushed
+// every BATCH_MS.
+const BATCH_LINES = 256;
+const BATCH_MS = 50;
+
+// Per-algorithm aggregate of the {"type":"stats"} records the binaries write
+// on exit (algorithms/stats.h); served by GET /stats.
+const STATS_SAMPLES = 200;
+const statsByAlgorithm = new Map();
+
+// The last DECISION_SAMPLES {"type":"decision"} records from auto-sort: the
+// input profile, the sort it chose and how long it took. Served by
+// GET /decisions for tuning its thresholds.
+const DECISION_SAMPLES = 1000;
+const decisions = [];
+
+const traceCache = new TraceCache({
+  maxBytes: (Number(process.env.TRACE_CACHE_MB) || 64) * (1 << 20),
+  dir: process.env.TRACE_CACHE_DIR || '',
+  maxDiskBytes: (Number(process.env.TRACE_CACHE_DISK_MB) || 512) * (1 << 20),
+});
+
+// Every run's steps are also kept on disk (algorithms/trace.h writes them,
+// traceStore.js reads them) so GET /trace/:runId can seek into any run,
+// finished or not, without rerunning it.
+const traceStore = new TraceStore({
+  dir: process.env.TRACE_STORE_DIR || path.join(os.tmpdir(), 'algo-traces'),
+  maxBytes: (Number(process.env.TRACE_STORE_MB) || 1024) * (1 << 20),
+});
+const TRACE_MAX_COUNT = 10000;
+
+// Routes whose binaries read or write named files only see DATA_DIR: their
+// path parameters are resolved inside it, and any that lead outside, or are
+// "-" (stdin/stdout), reject the run.
+const DATA_DIR = path.resolve(process.env.DATA_DIR || path.join(os.tmpdir(), 'algo-data'));
+fs.mkdirSync(DATA_DIR, { recursive: true });
+
+// Search limits (algorithms/budget.h). Every run gets RUN_TIMEOUT_MS unless
+// the request asks for less; binaries without cancellation points are killed
+// KILL_GRACE_MS after their deadline or after a /cancel request.
+const RUN_TIMEOUT_MS = Number(process.env.RUN_TIMEOUT_MS) || 10 * 60 * 1000;
+const KILL_GRACE_MS = 2000;
+// Exit status of a binary that stopped early and printed a partial result.
+const EXIT_STOPPED = 3;
+// Run ids name the stored trace files, so they must not repeat across restarts.
+const serverStart = Date.now().toString(36);
+let nextRunId = 1;
+const activeRuns = new Map();
+
+// Modes that read files or report timings: their output is not a function of the params alone.
+// Greedy takes options before 'file', so any argument can name the mode.
+const UNCACHED_MODES = new Set(['file', 'build', 'query', 'serve', 'bench', 'adaptive', 'count', 'convert', 'generate', 'engine', 'select-bench', 'auto-sort', 'decode']);
+// Records that carry timings say so themselves, whatever mode produced them
+// (knapsack, for one, switches to its timed search on large input).
+const UNCACHEABLE_RECORD = /"cacheable":\s*false/;
 
 app.post('/run-:algorithm', (req, res) => {
   const { algorithm } = req.params;
+  const files = resolveDataFiles(algorithm, req.body.array || []);
+  if (files.error) return res.status(400).json({ error: files.error });
   lastChoice = algorithm;
-  userParams = req.body.array || [];
+  userParams = files.params;
+  maxStepsPerSecond = Math.max(0, Number(req.body.maxStepsPerSecond) || 0);
+  searchLimits = {
+    timeLimitMs: Math.min(RUN_TIMEOUT_MS, Number(req.body.timeLimitMs) || RUN_TIMEOUT_MS),
+    nodeLimit: Math.max(0, Number(req.body.nodeLimit) || 0),
+  };
 
   console.log(`Running ${algorithm} with params:`, userParams);
-  res.sendStatus(200);
+  const run = startProcess();
+  res.json({ runId: run ? run.id : null });
+});
 
-  startProcess();
+// Asks the run to stop at its next cancellation point; it then streams its
+// best partial result. Binaries that never check are killed after a grace period.
+app.post('/cancel/:runId', (req, res) => {
+  const run = activeRuns.get(req.params.runId);
+  if (!run || run.done) return res.status(404).json({ error: 'No such active run' });
+  stopRun(run, 'cancelled');
+  res.status(202).json({ runId: run.id, status: 'cancelling' });
+});
+
+// GET /trace/:runId?from=<step>&count=<k>: k steps of a run from any step.
+// keyframe is the last full-state snapshot before `from`, for traces whose
+// steps are deltas; replay the steps from keyframe.step to reach `from`.
+app.get('/trace/:runId', async (req, res) => {
+  const { runId } = req.params;
+  if (!/^[\w-]+$/.test(runId)) return res.status(400).json({ error: 'Invalid run id' });
+  const from = Math.max(0, Math.floor(Number(req.query.from) || 0));
+  const count = Math.min(TRACE_MAX_COUNT, Math.max(1, Math.floor(Number(req.query.count) || 100)));
+  let result;
+  try {
+    result = await traceStore.read(runId, from, count);
+  } catch (err) {
+    return res.status(500).json({ error: err.message });
+  }
+  if (!result) return res.status(404).json({ error: 'No stored trace for this run' });
+  // The steps are already JSON; splice them in rather than parse them.
+  res.setHeader('Content-Type', 'application/json');
+  res.send(`{"runId":${JSON.stringify(runId)},"from":${from},"total":${result.total},`
+    + `"done":${!activeRuns.has(runId)},"keyframe":${result.keyframe || 'null'},"steps":[${result.steps.join(',')}]}`);
 });
 
 app.get('/stream', (req, res) => {
@@ -27,15 +143,55 @@ app.get('/stream', (req, res) => {
   res.setHeader('Cache-Control', 'no-cache');
   res.setHeader('Connection', 'keep-alive');
 
-  clients.push(res);
+  const client = { res, batch: req.query.batch === '1', cursor: 0, run: null, blocked: false, timer: null };
+  clients.push(client);
   req.on('close', () => {
-    clients = clients.filter(c => c !== res);
+    clients = clients.filter(c => c !== client);
+    clearTimeout(client.timer);
+    const run = client.run;
+    if (!run || run.done) return;
+    updateFlow(run);
   });
+
+  if (currentRun) attach(client, currentRun);
+});
+
+app.get('/stats', (req, res) => {
+  const percentile = (sorted, p) => sorted[Math.min(sorted.length - 1, Math.floor(p * sorted.length))];
+  const result = {};
+  for (const [algorithm, agg] of statsByAlgorithm) {
+    const wall = [...agg.wallMs].sort((a, b) => a - b);
+    const mean = totals => Object.fromEntries(Object.entries(totals).map(([k, v]) => [k, v / agg.runs]));
+    result[algorithm] = {
+      runs: agg.runs,
+      wallMs: { p50: percentile(wall, 0.5), p95: percentile(wall, 0.95), max: wall[wall.length - 1] },
+      meanCounters: mean(agg.counters),
+      meanPerf: mean(agg.perf),
+      maxRssKb: agg.maxRssKb,
+      last: agg.last,
+    };
+  }
+  res.json(result);
+});
+
+// Per chosen method: runs and mean sort time per element, plus the raw records.
+app.get('/decisions', (req, res) => {
+  const byMethod = {};
+  for (const d of decisions) {
+    const agg = byMethod[d.method] || (byMethod[d.method] = { runs: 0, elements: 0, sortMs: 0 });
+    agg.runs++;
+    agg.elements += d.n;
+    agg.sortMs += d.sortMs;
+  }
+  for (const agg of Object.values(byMethod)) {
+    agg.nsPerElement = agg.elements ? (agg.sortMs * 1e6) / agg.elements : 0;
+    delete agg.sortMs;
+  }
+  res.json({ byMethod, recent: decisions });
 });
 
 app.get('/pseudocode/:algorithm', (req, res) => {
   const algorithm = req.params.algorithm;
-  const pseudocode = require(`./algorithms/pseudocode.json`);
   if (pseudocode[algorithm]) {
     res.json(pseudocode[algorithm]);
   } else {
@@ -44,92 +200,442 @@ app.get('/pseudocode/:algorithm', (req, res) => {
 });
 
 
-function startProcess() {
-  if (!lastChoice) return;
+function attach(client, run) {
+  client.run = run;
+  client.cursor = 0;
+  pump(client);
+}
+
+// Writes the client's unread lines until the socket pushes back, then ends
+// the stream once a finished run has been fully delivered. A client's cursor
+// counts steps from the start of the run; run.lines holds those from run.base.
+function pump(client) {
+  const { run, res } = client;
+  client.timer = null;
+  if (client.reading === run) return;
+  if (client.cursor < run.base) return pumpStored(client);
+  while (!client.blocked && client.cursor < run.base + run.lines.length) {
+    const at = client.cursor - run.base;
+    let chunk;
+    if (client.batch) {
+      const end = Math.min(run.lines.length, at + BATCH_LINES);
+      chunk = `event: batch\ndata: [${run.lines.slice(at, end).join(',')}]\n\n`;
+      client.cursor = run.base + end;
+    } else {
+      chunk = `data: ${run.lines[at]}\n\n`;
+      client.cursor++;
+    }
+    send(client, chunk);
+  }
+  if (run.done && !client.blocked && client.cursor === run.base + run.lines.length) {
+    if (run.stats) res.write(`event: stats\ndata: ${run.stats}\n\n`);
+    res.write(run.tail);
+    res.end();
+    clients = clients.filter(c => c !== client);
+    run.delivered = true;
+    if (currentRun === run) currentRun = null;
+  }
+  updateFlow(run);
+}
+
+function send(client, chunk) {
+  if (client.res.write(chunk) || client.blocked) return;
+  client.blocked = true;
+  client.res.once('drain', () => {
+    client.blocked = false;
+    pump(client);
+  });
+}
+
+// Catches a client up on steps that have left the run's window, from its
+// stored trace, then goes back to pump.
+async function pumpStored(client) {
+  const { run } = client;
+  client.reading = run;
+  let result = null;
+  try {
+    result = await traceStore.read(run.id, client.cursor, Math.min(TRACE_MAX_COUNT, run.base - client.cursor));
+  } catch (err) {
+    console.error('Trace store read failed:', err.message);
+  }
+  client.reading = null;
+  if (client.run !== run || !clients.includes(client)) return;
+  if (!result) {
+    // Nothing stored for this run: the client misses the steps it held.
+    client.cursor = run.base;
+  } else if (!result.steps.length) {
+    client.timer = setTimeout(pump, STORE_RETRY_MS, client);
+    return;
+  } else if (client.batch) {
+    for (let i = 0; i < result.steps.length; i += BATCH_LINES) {
+      send(client, `event: batch\ndata: [${result.steps.slice(i, i + BATCH_LINES).join(',')}]\n\n`);
+    }
+    client.cursor += result.steps.length;
+  } else {
+    result.steps.forEach(step => send(client, `data: ${step}\n\n`));
+    client.cursor += result.steps.length;
+  }
+  if (!client.blocked) pump(client);
+}
+
+function updateFlow(run) {
+  if (!run.child || run.done) return;
+  // Clients catching up from the stored trace do not count: the binary has
+  // to keep running to flush the steps they are waiting for.
+  const end = run.base + run.lines.length;
+  const readers = clients.filter(c => c.run === run && c.cursor >= run.base);
+  const backlog = Math.max(0, ...readers.map(c => end - c.cursor));
+  if (backlog > HIGH_WATER && !run.paused) {
+    run.paused = true;
+    run.child.stdout.pause();
+  } else if (backlog <= LOW_WATER && run.paused) {
+    run.paused = false;
+    run.child.stdout.resume();
+  }
+}
+
+function recordStats(algorithm, line) {
+  let record;
+  try {
+    record = JSON.parse(line);
+  } catch {
+    return;
+  }
+  let agg = statsByAlgorithm.get(algorithm);
+  if (!agg) {
+    agg = { runs: 0, wallMs: [], counters: {}, perf: {}, maxRssKb: 0, last: null };
+    statsByAlgorithm.set(algorithm, agg);
+  }
+  agg.runs++;
+  agg.wallMs.push(record.wallMs);
+  if (agg.wallMs.length > STATS_SAMPLES) agg.wallMs.shift();
+  for (const [k, v] of Object.entries(record.counters || {})) agg.counters[k] = (agg.counters[k] || 0) + v;
+  for (const [k, v] of Object.entries(record.perf || {})) agg.perf[k] = (agg.perf[k] || 0) + v;
+  agg.maxRssKb = Math.max(agg.maxRssKb, record.maxRssKb || 0);
+  agg.last = record;
+}
+
+function stopRun(run, reason) {
+  if (!run.child || run.stopped) return;
+  run.stopped = reason;
+  run.child.stdin.write('cancel\n');
+  run.killTimer = setTimeout(() => run.child.kill(), KILL_GRACE_MS);
+}
+
+function emitLine(run, line) {
+  if (UNCACHEABLE_RECORD.test(line)) run.timed = true;
+  // Progress records are a live view, not steps: forward them as named
+  // events to the run's viewers and keep them out of the trace.
+  if (line.startsWith('{"type":"progress"')) {
+    clients.forEach(client => {
+      if (client.run === run && !client.blocked) client.res.write(`event: progress\ndata: ${line}\n\n`);
+    });
+    return;
+  }
+  // Decisions are not steps either: sample them for /decisions and send
+  // them as a named event.
+  if (line.startsWith('{"type":"decision"')) {
+    try {
+      decisions.push(JSON.parse(line));
+      if (decisions.length > DECISION_SAMPLES) decisions.shift();
+    } catch {}
+    clients.forEach(client => {
+      if (client.run === run && !client.blocked) client.res.write(`event: decision\ndata: ${line}\n\n`);
+    });
+    return;
+  }
+  // Stats are not steps: keep them out of the trace (and the cache) and
+  // send them as a named event before the end of the stream.
+  if (line.startsWith('{"type":"stats"')) {
+    run.stats = line;
+    recordStats(run.algorithm, line);
+    return;
+  }
+  run.lines.push(line);
+  if (run.kept) {
+    run.keptBytes += line.length + 1;
+    if (traceCache.fits(run.keptBytes)) run.kept.push(line);
+    else run.kept = null;
+  }
+  if (run.lines.length >= 2 * LIVE_LINES) {
+    const end = run.base + run.lines.length;
+    const floor = Math.min(end - LIVE_LINES, ...clients.filter(c => c.run === run && c.cursor >= run.base).map(c => c.cursor));
+    if (floor > run.base) {
+      run.lines.splice(0, floor - run.base);
+      run.base = floor;
+    }
+  }
+  clients.forEach(client => {
+    if (client.run !== run || client.blocked) return;
+    if (!client.batch) pump(client);
+    else if (!client.timer) client.timer = setTimeout(pump, BATCH_MS, client);
+  });
+  updateFlow(run);
+}
+
+function finishRun(run, tail = 'event: end\ndata: done\n\n') {
+  if (run.done) return;
+  run.done = true;
+  run.tail = tail;
+  clients.filter(c => c.run === run && !c.timer).forEach(pump);
+}
 
+// The arguments of a binary's command line that name files, as indices:
+// { inputs, outputs }. Decided from the binary's own mode words, so a
+// generic route reaches no mode its dedicated route would confine.
+function fileArgs(exe, args) {
+  switch (exe) {
+    case 'Greedy.exe': {
+      if (args[0] === 'convert') return { inputs: [1], outputs: [2] };
+      if (args[0] === 'generate') return { inputs: [], outputs: [3] };
+      if (args[0] === 'huffman') return args[1] === 'file' || args[1] === 'decode' ? { inputs: [2], outputs: [3] } : null;
+      const at = args.indexOf('file');
+      return at >= 0 ? { inputs: [at + 1], outputs: [] } : null;
+    }
+    case 'kmp.exe':
+      // file <path> <pattern> [threads]
+      return args.length > 2 && args[0] === 'file' ? { inputs: [1], outputs: [] } : null;
+    case 'aho_corasick.exe':
+      // file <text> <patterns, one per line>
+      return args.length > 2 && args[0] === 'file' ? { inputs: [1, 2], outputs: [] } : null;
+    case 'rabin_karp.exe':
+      // file <text> <pattern>...
+      return args.length > 2 && args[0] === 'file' ? { inputs: [1], outputs: [] } : null;
+    case 'suffix_array.exe':
+      // build <text> <index> | query <index> <pattern|@patterns file>...
+      if (args.length < 3) return null;
+      if (args[0] === 'build') return { inputs: [1], outputs: [2] };
+      if (args[0] === 'query') {
+        const listed = args.map((a, i) => (i > 1 && a.length > 1 && a[0] === '@' ? i : -1)).filter(i => i >= 0);
+        return { inputs: [1], outputs: [], listed };
+      }
+      return null;
+  }
+  return null;
+}
+
+// fileArgs for a route, as indices into its params: the route's own words
+// come first on the command line. `listed` arguments are "@<file>".
+function fileParams(choice, params) {
+  const { exePath, args } = resolveCommand(choice, params);
+  const files = fileArgs(path.basename(exePath), args);
+  if (!files) return null;
+  const skip = args.length - params.length;
+  const toParams = list => list.map(i => i - skip).filter(i => i >= 0);
+  return { inputs: toParams(files.inputs), outputs: toParams(files.outputs), listed: toParams(files.listed || []) };
+}
+
+// { params } with file parameters replaced by absolute paths in DATA_DIR, or
+// { error } when one would escape it or a run would overwrite its own input.
+function resolveDataFiles(choice, rawParams) {
+  const params = rawParams.map(String);
+  const files = fileParams(choice, params);
+  if (!files) return { params };
+  const resolve = name => {
+    if (name === '-') return { error: 'Files must be named: "-" (stdin/stdout) is not allowed' };
+    const full = path.resolve(DATA_DIR, name);
+    return full.startsWith(DATA_DIR + path.sep) ? { full } : { error: `${name} is outside the data directory` };
+  };
+  for (const i of [...files.inputs, ...files.outputs, ...files.listed]) {
+    if (i >= params.length) continue;
+    const listed = files.listed.includes(i);
+    const { full, error } = resolve(listed ? params[i].slice(1) : params[i]);
+    if (error) return { error };
+    params[i] = listed ? `@${full}` : full;
+  }
+  const inputs = files.inputs.map(i => params[i]);
+  if (files.outputs.some(i => i < params.length && inputs.includes(params[i])))
+    return { error: 'The output file must not be the input file' };
+  return { params };
+}
+
+function resolveCommand(choice, params) {
   const algoDir = path.resolve(__dirname, 'algorithms');
   let exePath;
   let args = [];
 
-  switch (lastChoice) {
+  switch (choice) {
     case 'dp-fibonacci':
       exePath = path.join(algoDir, 'fibonacci.exe');
-      args = userParams.map(String);
+      args = params.map(String);
       break;
     case 'dp-knapsack':
       exePath = path.join(algoDir, 'knapsack.exe');
-      args = userParams.map(String);
+      args = params.map(String);
+      break;
+    case 'dp-knapsack-bnb':
+      exePath = path.join(algoDir, 'knapsack.exe');
+      args = ['bnb', ...params.map(String)];
       break;
     case 'greedy':
       exePath = path.join(algoDir, 'Greedy.exe');
-      args = userParams.map(String);
+      args = params.map(String);
       break;
 
     case 'n-queen':
       exePath = path.join(algoDir, 'Backtracking.exe');
-      args = userParams.map(String);
+      args = params.map(String);
+      break;
+    case 'n-queen-count':
+      exePath = path.join(algoDir, 'Backtracking.exe');
+      args = ['count', ...params.map(String)];
       break;
     case 'string-kmp':
       exePath = path.join(algoDir, 'kmp.exe');
-      args = userParams.map(String);
+      args = params.map(String);
+      break;
+    case 'string-aho':
+      exePath = path.join(algoDir, 'aho_corasick.exe');
+      args = params.map(String);
+      break;
+    case 'string-suffix':
+      exePath = path.join(algoDir, 'suffix_array.exe');
+      args = params.map(String);
       break;
     case 'string-rabin':
       exePath = path.join(algoDir, 'rabin_karp.exe');
-      args = userParams.map(String);
+      args = params.map(String);
       break;
     case 'greedy-dijkstra':
       exePath = path.join(algoDir, 'Greedy.exe');
-      args = ['dijkstra', ...userParams.map(String)];
+      args = ['dijkstra', ...params.map(String)];
+      break;
+
+    case 'greedy-convert':
+      exePath = path.join(algoDir, 'Greedy.exe');
+      args = ['convert', ...params.map(String)];
+      break;
+    case 'greedy-generate':
+      exePath = path.join(algoDir, 'Greedy.exe');
+      args = ['generate', ...params.map(String)];
+      break;
+    case 'greedy-bench':
+      exePath = path.join(algoDir, 'Greedy.exe');
+      args = ['bench', ...params.map(String)];
+      break;
+    case 'greedy-huffman':
+      exePath = path.join(algoDir, 'Greedy.exe');
+      args = ['huffman', ...params.map(String)];
+      break;
+    case 'greedy-huffman-file':
+      exePath = path.join(algoDir, 'Greedy.exe');
+      args = ['huffman', 'file', ...params.map(String)];
+      break;
+    case 'greedy-delta-stepping':
+      exePath = path.join(algoDir, 'Greedy.exe');
+      args = ['delta-stepping', ...params.map(String)];
       break;
 
     case 'greedy-prims':
       exePath = path.join(algoDir, 'Greedy.exe');
-      args = ['prims', ...userParams.map(String)];
+      args = ['prims', ...params.map(String)];
       break;
     case 'greedy-kruskal':
       exePath = path.join(algoDir, 'Greedy.exe');
-      args = ['prims', ...userParams.map(String)];
+      args = ['prims', ...params.map(String)];
       break;
     case 'hamiltonian_cycle':
       exePath = path.join(algoDir, 'hamiltonian_cycle.exe');
-      args = userParams.map(String);
+      args = params.map(String);
+      break;
+    case 'hamiltonian_cycle-dp':
+      exePath = path.join(algoDir, 'hamiltonian_cycle.exe');
+      args = ['dp', ...params.map(String)];
+      break;
+    case 'hamiltonian_cycle-parallel':
+      exePath = path.join(algoDir, 'hamiltonian_cycle.exe');
+      args = ['parallel', ...params.map(String)];
+      break;
+    case 'sort-engine':
+      exePath = path.join(algoDir, 'SortingAlgorithm.exe');
+      args = ['engine', ...params.map(String)];
       break;
 
     default:
       // Generic algorithms
       exePath = path.join(algoDir, 'SortingAlgorithm.exe');
-      args = [lastChoice, ...userParams.map(String)];
+      args = [choice, ...params.map(String)];
       break;
   }
+  return { exePath, args };
+}
+
+function startProcess() {
+  if (!lastChoice) return null;
+
+  const { exePath, args } = resolveCommand(lastChoice, userParams);
+  const cacheable = !args.some(arg => UNCACHED_MODES.has(arg));
+  // The rate changes which steps the binary emits, so it is part of the key.
+  const key = TraceCache.key(lastChoice, maxStepsPerSecond ? [...userParams, `rate=${maxStepsPerSecond}`] : userParams);
+  if (currentRun && currentRun.child && !currentRun.done) currentRun.child.kill();
+  // kept: the whole trace, for the cache, while it is small enough to cache.
+  const run = currentRun = {
+    id: `${serverStart}-${nextRunId++}`, algorithm: lastChoice, lines: [], base: 0,
+    kept: cacheable ? [] : null, keptBytes: 0, done: false, child: null, paused: false,
+  };
+  clients.filter(c => !c.run).forEach(c => attach(c, run));
+
+  const cached = cacheable && traceCache.get(key);
+  if (cached) {
+    console.log(`Cache hit for ${lastChoice}:`, traceCache.stats());
+    // The cache already holds these lines; the run shares them whole.
+    run.lines = cached;
+    traceStore.write(run.id, cached);
+    finishRun(run);
+    return run;
+  }
 
   console.log('Spawning:', exePath, 'Args:', args);
 
-  const child = spawn(exePath, args);
+  // TRACE_MAX_RATE is read by algorithms/trace.h, which drops intermediate
+  // steps above that many per second; TRACE_FILE is where it stores the steps.
+  // SEARCH_* are read by algorithms/budget.h.
+  const env = {
+    ...process.env,
+    SEARCH_CANCEL_STDIN: '1',
+    SEARCH_TIME_LIMIT_MS: String(searchLimits.timeLimitMs),
+    ...(searchLimits.nodeLimit ? { SEARCH_NODE_LIMIT: String(searchLimits.nodeLimit) } : {}),
+    ...(maxStepsPerSecond ? { TRACE_MAX_RATE: String(maxStepsPerSecond) } : {}),
+    TRACE_FILE: traceStore.base(run.id),
+  };
+  const child = run.child = spawn(exePath, args, { env });
+  child.stdin.on('error', () => {});
+  activeRuns.set(run.id, run);
+  run.deadline = setTimeout(() => stopRun(run, 'timeout'), searchLimits.timeLimitMs + KILL_GRACE_MS);
+  let partial = '';
 
   child.stdout.on('data', (data) => {
-    const lines = data.toString().split('\n').filter(Boolean);
-    lines.forEach(line => {
-      clients.forEach(client => client.write(`data: ${line}\n\n`));
-    });
+    // A chunk can end mid-line; keep the tail for the next chunk.
+    const lines = (partial + data.toString()).split('\n');
+    partial = lines.pop();
+    lines.filter(Boolean).forEach(line => emitLine(run, line));
   });
 
   child.on('close', (code) => {
     console.log(`Exited with code ${code}`);
-    clients.forEach(c => {
-      c.write('event: end\ndata: done\n\n');
-      c.end();
-    });
-    clients = [];
+    clearTimeout(run.deadline);
+    clearTimeout(run.killTimer);
+    activeRuns.delete(run.id);
+    traceStore.trim(activeRuns);
+    if (partial) emitLine(run, partial);
+    // Only complete runs are cached: a limited search would replay its partial result.
+    if (code === 0 && !run.stopped && run.kept && !run.timed && !searchLimits.nodeLimit) traceCache.set(key, run.kept);
+    if (code === EXIT_STOPPED || run.stopped) {
+      const reason = run.stopped || 'budget';
+      finishRun(run, `event: stopped\ndata: ${JSON.stringify({ runId: run.id, reason })}\n\nevent: end\ndata: done\n\n`);
+    } else {
+      finishRun(run);
+    }
   });
 
   child.on('error', (err) => {
     console.error('Spawn error:', err);
-    clients.forEach(c => {
-      c.write(`event: error\ndata: ${JSON.stringify(err.message)}\n\n`);
-      c.end();
-    });
-    clients = [];
+    clearTimeout(run.deadline);
+    activeRuns.delete(run.id);
+    finishRun(run, `event: error\ndata: ${JSON.stringify(err.message)}\n\n`);
   });
+
+  return run;
 }
 
 app.listen(5000, () => console.log('Server running on http://localhost:5000'));
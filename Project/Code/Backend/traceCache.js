@@ -0,0 +1,105 @@
+const crypto = require('crypto');
+const fs = require('fs');
+const path = require('path');
+
+// Content-addressed store of complete trace outputs. Keys hash the algorithm
+// name plus its parameters exactly as they reach the binary's argv, so 5 and
+// '5' share an entry but '007' and '7' (or ' ab' and 'ab') do not.
+// Entries live in a byte-bounded LRU in memory and, when a directory is
+// configured, as <key>.jsonl files trimmed oldest-first to their own budget.
+class TraceCache {
+  constructor({ maxBytes = 64 << 20, dir = '', maxDiskBytes = 512 << 20 } = {}) {
+    this.maxBytes = maxBytes;
+    this.maxDiskBytes = maxDiskBytes;
+    this.dir = dir;
+    this.entries = new Map();
+    this.bytes = 0;
+    this.hits = 0;
+    this.misses = 0;
+    if (this.dir) fs.mkdirSync(this.dir, { recursive: true });
+  }
+
+  static key(algorithm, params) {
+    const argv = JSON.stringify([algorithm, ...params.map(String)]);
+    return crypto.createHash('sha256').update(argv).digest('hex');
+  }
+
+  get(key) {
+    const entry = this.entries.get(key);
+    let lines = entry && entry.lines;
+    if (entry) {
+      // Re-insert to mark as most recently used.
+      this.entries.delete(key);
+      this.entries.set(key, entry);
+    } else if (this.dir) {
+      const file = path.join(this.dir, `${key}.jsonl`);
+      try {
+        lines = fs.readFileSync(file, 'utf8').split('\n').filter(Boolean);
+        const now = new Date();
+        fs.utimesSync(file, now, now);
+        this.remember(key, lines);
+      } catch {
+        lines = undefined;
+      }
+    }
+    if (lines) this.hits++;
+    else this.misses++;
+    return lines;
+  }
+
+  set(key, lines) {
+    if (!this.remember(key, lines) || !this.dir) return;
+    fs.writeFile(path.join(this.dir, `${key}.jsonl`), lines.join('\n') + '\n', err => {
+      if (err) console.error('Trace cache write failed:', err.message);
+      else this.trimDisk();
+    });
+  }
+
+  // Whether a trace of `size` bytes is small enough to be worth holding.
+  fits(size) {
+    return size <= this.maxBytes / 4;
+  }
+
+  // Returns false for traces too large to be worth holding.
+  remember(key, lines) {
+    const size = lines.reduce((sum, line) => sum + line.length + 1, 0);
+    if (!this.fits(size)) return false;
+    if (this.entries.has(key)) this.bytes -= this.entries.get(key).size;
+    this.entries.delete(key);
+    this.entries.set(key, { lines, size });
+    this.bytes += size;
+    for (const [oldest, value] of this.entries) {
+      if (this.bytes <= this.maxBytes) break;
+      this.entries.delete(oldest);
+      this.bytes -= value.size;
+    }
+    return true;
+  }
+
+  trimDisk() {
+    let files;
+    try {
+      files = fs.readdirSync(this.dir)
+        .filter(name => name.endsWith('.jsonl'))
+        .map(name => {
+          const stat = fs.statSync(path.join(this.dir, name));
+          return { name, size: stat.size, mtime: stat.mtimeMs };
+        })
+        .sort((a, b) => a.mtime - b.mtime);
+    } catch {
+      return;
+    }
+    let total = files.reduce((sum, f) => sum + f.size, 0);
+    for (const f of files) {
+      if (total <= this.maxDiskBytes) break;
+      fs.rm(path.join(this.dir, f.name), { force: true }, () => {});
+      total -= f.size;
+    }
+  }
+
+  stats() {
+    return { entries: this.entries.size, bytes: this.bytes, hits: this.hits, misses: this.misses };
+  }
+}
+
+module.exports = TraceCache;
@@ -0,0 +1,175 @@
+const fs = require('fs');
+const path = require('path');
+const { StringDecoder } = require('string_decoder');
+
+// Reader for the per-run trace files written by algorithms/trace.h (see the
+// format there): <runId>.trace holds the step lines, <runId>.idx one record
+// per INTERVAL steps with the byte offset of that step and of the last
+// keyframe in <runId>.keys. A seek reads one index record and at most
+// INTERVAL - 1 lines before the requested step, with positioned reads, so it
+// costs the same at step 10 as at step 10,000,000 and needs no rerun.
+const HEADER_BYTES = 16;
+const RECORD_BYTES = 16;
+const CHUNK_BYTES = 1 << 16;
+
+class TraceStore {
+  constructor({ dir, maxBytes = 1 << 30 }) {
+    this.dir = dir;
+    this.maxBytes = maxBytes;
+    fs.mkdirSync(dir, { recursive: true });
+  }
+
+  base(runId) {
+    return path.join(this.dir, runId);
+  }
+
+  // Lines starting at byte `position` of the file, until `count` lines have
+  // been read (after skipping `skip`) or the file ends. Only complete lines
+  // are returned, so a trace that is still being written reads cleanly.
+  static async readLines(handle, position, skip, count) {
+    const lines = [];
+    let rest = '';
+    const buffer = Buffer.alloc(CHUNK_BYTES);
+    const decoder = new StringDecoder('utf8');     // keeps characters split across chunks whole
+    while (lines.length < count) {
+      const { bytesRead } = await handle.read(buffer, 0, CHUNK_BYTES, position);
+      if (bytesRead === 0) break;
+      position += bytesRead;
+      const parts = (rest + decoder.write(buffer.subarray(0, bytesRead))).split('\n');
+      rest = parts.pop();
+      for (const line of parts) {
+        if (skip > 0) skip--;
+        else if (lines.length < count) lines.push(line);
+      }
+    }
+    return lines;
+  }
+
+  static async countLines(handle, position) {
+    let lines = 0;
+    const buffer = Buffer.alloc(CHUNK_BYTES);
+    for (;;) {
+      const { bytesRead } = await handle.read(buffer, 0, CHUNK_BYTES, position);
+      if (bytesRead === 0) return lines;
+      position += bytesRead;
+      for (let i = 0; i < bytesRead; i++) if (buffer[i] === 10) lines++;
+    }
+  }
+
+  // { total, keyframe, steps } for steps [from, from + count), or null when
+  // the run has no stored trace. steps and keyframe are raw JSON text.
+  async read(runId, from, count) {
+    const base = this.base(runId);
+    let index, trace;
+    try {
+      index = await fs.promises.open(`${base}.idx`, 'r');
+      trace = await fs.promises.open(`${base}.trace`, 'r');
+    } catch {
+      if (index) await index.close();
+      return null;
+    }
+    try {
+      const header = Buffer.alloc(HEADER_BYTES);
+      await index.read(header, 0, HEADER_BYTES, 0);
+      if (header.toString('latin1', 0, 8) !== 'TRACEIDX' || header.readUInt32LE(8) !== 1) return null;
+      const interval = header.readUInt32LE(12);
+      const records = Math.floor(((await index.stat()).size - HEADER_BYTES) / RECORD_BYTES);
+      if (records === 0) return { total: 0, keyframe: null, steps: [] };
+
+      const record = async i => {
+        const buffer = Buffer.alloc(RECORD_BYTES);
+        await index.read(buffer, 0, RECORD_BYTES, HEADER_BYTES + i * RECORD_BYTES);
+        return { offset: Number(buffer.readBigInt64LE(0)), keyframe: Number(buffer.readBigInt64LE(8)) };
+      };
+      const last = await record(records - 1);
+      const total = (records - 1) * interval + await TraceStore.countLines(trace, last.offset);
+      if (from >= total) return { total, keyframe: null, steps: [] };
+
+      // A live trace's index can trail its steps (both are buffered): seek
+      // from the last record written and skip the rest.
+      const at = Math.min(Math.floor(from / interval), records - 1);
+      const start = await record(at);
+      const steps = await TraceStore.readLines(trace, start.offset, from - at * interval, Math.min(count, total - from));
+      const keyframe = await this.keyframeAt(base, Math.max(start.keyframe, 0), from);
+      return { total, keyframe, steps };
+    } finally {
+      await index.close();
+      await trace.close();
+    }
+  }
+
+  // The last keyframe before step `from`: the index points at the last one
+  // before its first step (-1 when there was none yet, so the scan starts at
+  // the top of .keys), and a few more may follow before `from`.
+  async keyframeAt(base, offset, from) {
+    const keys = await fs.promises.open(`${base}.keys`, 'r');
+    try {
+      let found = null;
+      for (;;) {
+        const [line] = await TraceStore.readLines(keys, offset, 0, 1);
+        const step = line && Number((/^\{"step":(\d+)/.exec(line) || [])[1]);
+        if (!line || step > from) return found;
+        found = line;
+        offset += Buffer.byteLength(line) + 1;
+      }
+    } finally {
+      await keys.close();
+    }
+  }
+
+  // Stores a trace the server already has in memory (a cache replay) in the
+  // same format, without keyframes.
+  write(runId, lines, interval = 256) {
+    const base = this.base(runId);
+    const records = Buffer.alloc(HEADER_BYTES + Math.ceil(lines.length / interval) * RECORD_BYTES);
+    records.write('TRACEIDX', 0, 'latin1');
+    records.writeUInt32LE(1, 8);
+    records.writeUInt32LE(interval, 12);
+    let offset = 0;
+    lines.forEach((line, i) => {
+      if (i % interval === 0) {
+        const at = HEADER_BYTES + (i / interval) * RECORD_BYTES;
+        records.writeBigInt64LE(BigInt(offset), at);
+        records.writeBigInt64LE(-1n, at + 8);
+      }
+      offset += Buffer.byteLength(line) + 1;
+    });
+    const text = lines.length ? lines.join('\n') + '\n' : '';
+    return Promise.all([
+      fs.promises.writeFile(`${base}.trace`, text),
+      fs.promises.writeFile(`${base}.keys`, ''),
+      fs.promises.writeFile(`${base}.idx`, records),
+    ]).catch(err => console.error('Trace store write failed:', err.message));
+  }
+
+  // Deletes the oldest runs' files until the directory fits in maxBytes,
+  // never those of the runs in `active`.
+  trim(active) {
+    fs.readdir(this.dir, (err, names) => {
+      if (err) return;
+      const runs = new Map();
+      for (const name of names) {
+        const runId = name.replace(/\.(trace|idx|keys)$/, '');
+        if (runId === name || active.has(runId)) continue;
+        let stat;
+        try {
+          stat = fs.statSync(path.join(this.dir, name));
+        } catch {
+          continue;
+        }
+        const run = runs.get(runId) || { bytes: 0, mtime: 0 };
+        run.bytes += stat.size;
+        run.mtime = Math.max(run.mtime, stat.mtimeMs);
+        runs.set(runId, run);
+      }
+      let total = [...runs.values()].reduce((sum, run) => sum + run.bytes, 0);
+      for (const [runId, run] of [...runs].sort((a, b) => a[1].mtime - b[1].mtime)) {
+        if (total <= this.maxBytes) break;
+        for (const ext of ['trace', 'idx', 'keys']) fs.rm(`${this.base(runId)}.${ext}`, { force: true }, () => {});
+        total -= run.bytes;
+      }
+    });
+  }
+}
+
+module.exports = TraceStore;